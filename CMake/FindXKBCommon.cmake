@@ -0,0 +1,24 @@
+# - Find xkbcommon
+# Find the xkbcommon libraries
+#
+#  This module defines the following variables:
+#     XKBCOMMON_FOUND        - true if XKBCOMMON_INCLUDE_DIR & XKBCOMMON_LIBRARY are found
+#     XKBCOMMON_LIBRARIES    - Set when XKBCOMMON_LIBRARY is found
+#     XKBCOMMON_INCLUDE_DIRS - Set when XKBCOMMON_INCLUDE_DIR is found
+#
+#     XKBCOMMON_INCLUDE_DIR  - where to find xkbcommon/xkbcommon.h, etc.
+#     XKBCOMMON_LIBRARY      - the xkbcommon library
+#
+
+find_path(XKBCOMMON_INCLUDE_DIR NAMES xkbcommon/xkbcommon.h)
+find_library(XKBCOMMON_LIBRARY NAMES xkbcommon)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(xkbcommon DEFAULT_MSG XKBCOMMON_LIBRARY XKBCOMMON_INCLUDE_DIR)
+
+if (XKBCOMMON_FOUND)
+   set(XKBCOMMON_LIBRARIES ${XKBCOMMON_LIBRARY})
+   set(XKBCOMMON_INCLUDE_DIRS ${XKBCOMMON_INCLUDE_DIR})
+endif ()
+
+mark_as_advanced(XKBCOMMON_INCLUDE_DIR XKBCOMMON_LIBRARY)
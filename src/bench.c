@@ -0,0 +1,309 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "layout.h"
+#include "client.h"
+#include "space.h"
+#include "pixels.h"
+#include "encode.h"
+
+// Headless benchmarks, these do not need wlc or a running compositor.
+// Usage: loliwm-bench [name ...]
+
+static uint64_t
+now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t
+iterations_for(uint32_t memb)
+{
+   // Aim for roughly the same amount of work per sample.
+   uint32_t n = 2000000 / (memb ? memb : 1);
+   return (n < 10 ? 10 : n);
+}
+
+static void
+bench_layout(void)
+{
+   static const uint32_t sizes[] = { 10, 100, 1000, 10000 };
+   static const struct wlc_size resolution = { 3840, 2160 };
+
+   printf("%-24s %8s %12s %14s\n", "layout", "views", "iterations", "ns/relayout");
+
+   for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+      struct layout_item *items;
+      if (!(items = calloc(sizes[s], sizeof(struct layout_item))))
+         return;
+
+      // Mostly terminals, with a dialog every 16 views to exercise the parent path.
+      for (uint32_t i = 0; i < sizes[s]; ++i) {
+         items[i].kind = (i % 16 == 15 ? LAYOUT_DIALOG : LAYOUT_TILED);
+         items[i].geometry = (struct wlc_geometry){ { 0, 0 }, { 640, 480 } };
+         items[i].parent = items[i].root = &items[i - (i % 16)].geometry;
+      }
+
+      const uint32_t iterations = iterations_for(sizes[s]);
+      const uint64_t start = now_ns();
+      for (uint32_t i = 0; i < iterations; ++i)
+         layout_space(items, sizes[s], &resolution, 0.5f + (i & 1) * 0.01f);
+      const uint64_t elapsed = now_ns() - start;
+
+      printf("%-24s %8u %12u %14.1f\n", "layout_space", sizes[s], iterations, (double)elapsed / iterations);
+      free(items);
+   }
+}
+
+struct legacy_view {
+   struct wl_list link;
+   bool tiled;
+};
+
+static void
+legacy_cycle(struct wl_list *l)
+{
+   // What cycle() used to do, rotate the whole views list until a tiled view comes first.
+   struct legacy_view *v = NULL;
+   struct wl_list *p;
+   do {
+      p = l->prev;
+      wl_list_remove(l->prev);
+      wl_list_insert(l, p);
+      v = wl_container_of(p, v, link);
+   } while (!v->tiled);
+}
+
+static void
+bench_cycle(void)
+{
+   static const uint32_t untiled[] = { 0, 10, 100, 1000, 10000 };
+   const uint32_t tiled = 8, iterations = 100000;
+
+   printf("%-24s %8s %12s %14s\n", "cycle", "untiled", "iterations", "ns/cycle");
+
+   for (uint32_t u = 0; u < sizeof(untiled) / sizeof(untiled[0]); ++u) {
+      const uint32_t memb = tiled + untiled[u];
+
+      struct space *space;
+      struct legacy_view *views;
+      if (!(space = space_new(NULL)) || !(views = calloc(memb, sizeof(struct legacy_view))))
+         return;
+
+      // Interleave popups and dialogs between the tiled views, like a busy space would.
+      struct wl_list legacy;
+      wl_list_init(&legacy);
+      for (uint32_t i = 0; i < memb; ++i) {
+         views[i].tiled = (i % (memb / tiled) == 0 && i / (memb / tiled) < tiled);
+         wl_list_insert(legacy.prev, &views[i].link);
+
+         struct client *c;
+         if (!views[i].tiled || !(c = client_add((struct wlc_view*)&views[i])))
+            continue;
+
+         space_tile(space, c, (space->tiled_count ? wl_container_of(space->tiled.prev, c, tiled_link) : NULL));
+      }
+
+      uint64_t start = now_ns();
+      for (uint32_t i = 0; i < iterations; ++i)
+         space_cycle(space);
+      const uint64_t elapsed = now_ns() - start;
+
+      start = now_ns();
+      for (uint32_t i = 0; i < iterations; ++i)
+         legacy_cycle(&legacy);
+      const uint64_t legacy_elapsed = now_ns() - start;
+
+      printf("%-24s %8u %12u %14.1f\n", "space_cycle", untiled[u], iterations, (double)elapsed / iterations);
+      printf("%-24s %8u %12u %14.1f\n", "rotate views (old)", untiled[u], iterations, (double)legacy_elapsed / iterations);
+
+      space_free(space);
+      client_release();
+      free(views);
+   }
+}
+
+static void
+legacy_rgba_to_rgb(uint8_t *rgb, const uint8_t *rgba, uint32_t w, uint32_t h)
+{
+   // What store_rgba() used to do, convert and then flip in a second pass.
+   for (uint32_t i = 0, c = 0; i < w * h * 4; i += 4, c += 3)
+      memcpy(rgb + c, rgba + i, 3);
+
+   for (uint32_t i = 0; i * 2 < h; ++i) {
+      uint32_t o = i * w * 3;
+      uint32_t r = (h - 1 - i) * w * 3;
+      for (uint32_t i2 = w * 3; i2 > 0; --i2, ++o, ++r) {
+         uint8_t temp = rgb[o];
+         rgb[o] = rgb[r];
+         rgb[r] = temp;
+      }
+   }
+}
+
+static void
+bench_pixels(void)
+{
+   static const struct wlc_size sizes[] = { { 1920, 1080 }, { 3840, 2160 }, { 1366, 767 } };
+   static const char *impls[] = { "legacy", "scalar", "sse2", "avx2", NULL };
+
+   printf("%-24s %12s %12s %10s\n", "pixels", "frame", "ms/frame", "GB/s");
+
+   for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+      const uint32_t w = sizes[s].w, h = sizes[s].h, iterations = 20;
+
+      uint8_t *rgba, *rgb, *expected;
+      if (!(rgba = malloc(w * h * 4)) || !(rgb = malloc(w * h * 3)) || !(expected = malloc(w * h * 3)))
+         return;
+
+      srand(s);
+      for (uint32_t i = 0; i < w * h * 4; ++i)
+         rgba[i] = rand();
+
+      legacy_rgba_to_rgb(expected, rgba, w, h);
+
+      char frame[32];
+      snprintf(frame, sizeof(frame), "%ux%u", w, h);
+
+      for (uint32_t i = 0; impls[i]; ++i) {
+         const bool legacy = !strcmp(impls[i], "legacy");
+         if (!legacy && !pixels_use(impls[i]))
+            continue;
+
+         memset(rgb, 0, w * h * 3);
+         const uint64_t start = now_ns();
+         for (uint32_t n = 0; n < iterations; ++n) {
+            if (legacy) {
+               legacy_rgba_to_rgb(rgb, rgba, w, h);
+            } else {
+               pixels_rgba_to_rgb(rgb, rgba, w, h);
+            }
+         }
+         const double ns = (double)(now_ns() - start) / iterations;
+
+         printf("%-24s %12s %12.2f %10.2f%s\n", impls[i], frame, ns / 1e6, (w * h * 7.0) / ns,
+               (memcmp(rgb, expected, w * h * 3) ? "  MISMATCH" : ""));
+      }
+
+      free(expected);
+      free(rgb);
+      free(rgba);
+   }
+}
+
+static void
+fill_desktop(uint8_t *rgb, uint32_t w, uint32_t h)
+{
+   // Roughly what a screen looks like: flat panels, a gradient wallpaper and some busy text-like areas.
+   srand(0);
+   for (uint32_t y = 0; y < h; ++y) {
+      for (uint32_t x = 0; x < w; ++x) {
+         uint8_t *p = rgb + ((size_t)y * w + x) * 3;
+         if (y < 24) {
+            p[0] = 0x22; p[1] = 0x22; p[2] = 0x22;
+         } else if (x < w / 2 && y < h * 3 / 4) {
+            const bool ink = ((y / 16) % 2 == 0 && (x / 7) % 9 != 0 && rand() % 3 == 0);
+            p[0] = p[1] = p[2] = (ink ? 0xdd : 0x10);
+         } else {
+            p[0] = x * 255 / w; p[1] = y * 255 / h; p[2] = 0x80;
+         }
+      }
+   }
+}
+
+static void
+bench_encode(void)
+{
+   static const struct wlc_size sizes[] = { { 1920, 1080 }, { 3840, 2160 } };
+   static const struct {
+      const char *name;
+      enum encode_format format;
+      uint32_t threads;
+   } encoders[] = {
+      { "ppm", ENCODE_PPM, 0 },
+      { "qoi", ENCODE_QOI, 0 },
+      { "png (1 thread)", ENCODE_PNG, 1 },
+      { "png (all cpus)", ENCODE_PNG, 0 },
+   };
+
+   printf("%-24s %12s %12s %12s\n", "encode", "frame", "ms/frame", "KiB");
+
+   for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+      const uint32_t w = sizes[s].w, h = sizes[s].h, iterations = 5;
+
+      uint8_t *rgb;
+      if (!(rgb = malloc(w * h * 3)))
+         return;
+
+      fill_desktop(rgb, w, h);
+
+      char frame[32];
+      snprintf(frame, sizeof(frame), "%ux%u", w, h);
+
+      for (uint32_t i = 0; i < sizeof(encoders) / sizeof(encoders[0]); ++i) {
+         FILE *f;
+         if (!(f = tmpfile()))
+            break;
+
+         bool ok = true;
+         const uint64_t start = now_ns();
+         for (uint32_t n = 0; n < iterations; ++n) {
+            rewind(f);
+            if (encoders[i].format == ENCODE_PNG) {
+               ok = ok && encode_png(f, rgb, w, h, encoders[i].threads);
+            } else {
+               ok = ok && encode(encoders[i].format, f, rgb, w, h);
+            }
+         }
+         const double ns = (double)(now_ns() - start) / iterations;
+
+         printf("%-24s %12s %12.2f %12ld%s\n", encoders[i].name, frame, ns / 1e6, ftell(f) / 1024, (ok ? "" : "  FAILED"));
+         fclose(f);
+      }
+
+      free(rgb);
+   }
+}
+
+static const struct {
+   const char *name;
+   void (*run)(void);
+} benches[] = {
+   { "layout", bench_layout },
+   { "cycle", bench_cycle },
+   { "pixels", bench_pixels },
+   { "encode", bench_encode },
+   { NULL, NULL },
+};
+
+static bool
+selected(const char *name, int argc, char *argv[])
+{
+   if (argc < 2)
+      return true;
+
+   for (int i = 1; i < argc; ++i)
+      if (!strcmp(argv[i], name))
+         return true;
+
+   return false;
+}
+
+int
+main(int argc, char *argv[])
+{
+   for (int i = 0; benches[i].name; ++i) {
+      if (!selected(benches[i].name, argc, argv))
+         continue;
+
+      benches[i].run();
+      printf("\n");
+   }
+
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,331 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <wlc.h>
+#include <xkbcommon/xkbcommon.h>
+#include "bindings.h"
+#include "config.h"
+
+static const struct {
+   const char *name;
+   enum action action;
+   bool needs_view, takes_arg;
+} actions[] = {
+   { "none", ACTION_NONE, false, false },
+   { "exit", ACTION_EXIT, false, false },
+   { "close", ACTION_CLOSE, true, false },
+   { "terminal", ACTION_TERMINAL, false, false },
+   { "menu", ACTION_MENU, false, false },
+   { "fullscreen", ACTION_FULLSCREEN, true, false },
+   { "cycle", ACTION_CYCLE, false, false },
+   { "nmaster-expand", ACTION_NMASTER_EXPAND, false, false },
+   { "nmaster-shrink", ACTION_NMASTER_SHRINK, false, false },
+   { "focus-space", ACTION_FOCUS_SPACE, false, true },
+   { "move-to-space", ACTION_MOVE_TO_SPACE, true, true },
+   { "move-to-output", ACTION_MOVE_TO_OUTPUT, true, true },
+   { "rotate-output", ACTION_ROTATE_OUTPUT, false, false },
+   { "focus-previous-view", ACTION_FOCUS_PREVIOUS_VIEW, true, false },
+   { "focus-next-view", ACTION_FOCUS_NEXT_VIEW, true, false },
+   { "screenshot", ACTION_SCREENSHOT, false, false },
+   { "screenshot-view", ACTION_SCREENSHOT_VIEW, true, false },
+   { "screenshot-region", ACTION_SCREENSHOT_REGION, false, false },
+   { "record", ACTION_RECORD, false, false },
+   { NULL, ACTION_NONE, false, false },
+};
+
+static const struct {
+   const char *name;
+   enum wlc_modifier_bit mod;
+} modifiers[] = {
+   { "shift", WLC_BIT_MOD_SHIFT },
+   { "caps", WLC_BIT_MOD_CAPS },
+   { "ctrl", WLC_BIT_MOD_CTRL },
+   { "alt", WLC_BIT_MOD_ALT },
+   { "mod2", WLC_BIT_MOD_MOD2 },
+   { "mod3", WLC_BIT_MOD_MOD3 },
+   { "logo", WLC_BIT_MOD_LOGO },
+   { "mod5", WLC_BIT_MOD_MOD5 },
+   { NULL, 0 },
+};
+
+static const struct {
+   uint32_t sym;
+   enum action action;
+   uint32_t arg;
+} defaults[] = {
+   { EXIT_KEY, ACTION_EXIT, 0 },
+   { CLOSE_FOCUS_KEY, ACTION_CLOSE, 0 },
+   { TERM_OPEN_KEY, ACTION_TERMINAL, 0 },
+   { MENU_OPEN_KEY, ACTION_MENU, 0 },
+   { TOGGLE_FULLSCREEN_KEY, ACTION_FULLSCREEN, 0 },
+   { CYCLE_CLIENT_KEY, ACTION_CYCLE, 0 },
+   { NMASTER_EXPAND_KEY, ACTION_NMASTER_EXPAND, 0 },
+   { NMASTER_SHRINK_KEY, ACTION_NMASTER_SHRINK, 0 },
+   { MOVE_FOCUS_OUTPUT_ONE, ACTION_MOVE_TO_OUTPUT, 0 },
+   { MOVE_FOCUS_OUTPUT_TWO, ACTION_MOVE_TO_OUTPUT, 1 },
+   { MOVE_FOCUS_OUTPUT_THREE, ACTION_MOVE_TO_OUTPUT, 2 },
+   { MOVE_FOCUS_OUTPUT_FOUR, ACTION_MOVE_TO_OUTPUT, 3 },
+   { MOVE_FOCUS_OUTPUT_FIVE, ACTION_MOVE_TO_OUTPUT, 4 },
+   { MOVE_FOCUS_OUTPUT_SIX, ACTION_MOVE_TO_OUTPUT, 5 },
+   { MOVE_FOCUS_OUTPUT_SEVEN, ACTION_MOVE_TO_OUTPUT, 6 },
+   { MOVE_FOCUS_OUTPUT_EIGHT, ACTION_MOVE_TO_OUTPUT, 7 },
+   { ROTATE_OUTPUT_FOCUS_KEY, ACTION_ROTATE_OUTPUT, 0 },
+   { MOVE_CLIENT_FOCUS_LEFT, ACTION_FOCUS_PREVIOUS_VIEW, 0 },
+   { MOVE_CLIENT_FOCUS_RIGHT, ACTION_FOCUS_NEXT_VIEW, 0 },
+   { SCREENSHOT_KEY, ACTION_SCREENSHOT, 0 },
+   { SCREENSHOT_VIEW_KEY, ACTION_SCREENSHOT_VIEW, 0 },
+   { SCREENSHOT_REGION_KEY, ACTION_SCREENSHOT_REGION, 0 },
+   { RECORD_TOGGLE_KEY, ACTION_RECORD, 0 },
+};
+
+// Open addressing with linear probing, the table is rebuilt as a whole on load.
+static struct {
+   struct binding *slots;
+   uint32_t capacity;
+} map;
+
+// Bindings in the order they were read, later ones win.
+struct list {
+   struct binding *items;
+   uint32_t memb, capacity;
+};
+
+static uint32_t
+hash(uint32_t mods, uint32_t sym)
+{
+   uint64_t h = ((uint64_t)mods << 32) | sym;
+   h ^= h >> 33;
+   h *= 0xff51afd7ed558ccdULL;
+   h ^= h >> 33;
+   return (uint32_t)h;
+}
+
+static uint32_t
+find_slot(struct binding *slots, uint32_t capacity, uint32_t mods, uint32_t sym)
+{
+   uint32_t mask = capacity - 1, i = hash(mods, sym) & mask;
+   while (slots[i].sym && (slots[i].mods != mods || slots[i].sym != sym))
+      i = (i + 1) & mask;
+   return i;
+}
+
+static bool
+push(struct list *list, const struct binding *binding)
+{
+   if (list->memb >= list->capacity) {
+      const uint32_t capacity = (list->capacity ? list->capacity * 2 : 64);
+      struct binding *items;
+      if (!(items = realloc(list->items, capacity * sizeof(struct binding))))
+         return false;
+
+      list->items = items;
+      list->capacity = capacity;
+   }
+
+   list->items[list->memb++] = *binding;
+   return true;
+}
+
+static int
+action_for_name(const char *name)
+{
+   for (int i = 0; actions[i].name; ++i) {
+      if (!strcmp(actions[i].name, name))
+         return i;
+   }
+   return -1;
+}
+
+static int
+action_index(enum action action)
+{
+   for (int i = 0; actions[i].name; ++i) {
+      if (actions[i].action == action)
+         return i;
+   }
+   return 0;
+}
+
+// With shift held wlc passes the shifted keysym, Q for q. Letters are bound and looked up
+// lowercase so mod+shift+q fires, other shifted keys have to be named as they are shifted.
+static uint32_t
+unshifted(uint32_t mods, uint32_t sym)
+{
+   return (mods & WLC_BIT_MOD_SHIFT ? xkb_keysym_to_lower(sym) : sym);
+}
+
+static bool
+parse_combo(char *combo, uint32_t prefix, uint32_t *mods, uint32_t *sym)
+{
+   *mods = 0;
+
+   // Everything before the last '+' is a modifier, the rest is keysym name ("plus" for +).
+   char *key = combo, *plus;
+   while ((plus = strchr(key, '+')) && plus[1]) {
+      *plus = 0;
+
+      if (!strcmp(key, "mod")) {
+         *mods |= prefix;
+      } else {
+         int i;
+         for (i = 0; modifiers[i].name && strcmp(modifiers[i].name, key); ++i);
+         if (!modifiers[i].name)
+            return false;
+         *mods |= modifiers[i].mod;
+      }
+
+      key = plus + 1;
+   }
+
+   xkb_keysym_t ks;
+   if (!(ks = xkb_keysym_from_name(key, XKB_KEYSYM_NO_FLAGS)) && !(ks = xkb_keysym_from_name(key, XKB_KEYSYM_CASE_INSENSITIVE)))
+      return false;
+
+   *sym = unshifted(*mods, ks);
+   return true;
+}
+
+static bool
+parse_line(char *line, uint32_t prefix, struct binding *out)
+{
+   const char *sep = " \t\r\n";
+   char *save, *combo, *name, *arg;
+   if (!(combo = strtok_r(line, sep, &save)) || !(name = strtok_r(NULL, sep, &save)))
+      return false;
+
+   arg = strtok_r(NULL, sep, &save);
+
+   int a;
+   if ((a = action_for_name(name)) < 0 || !parse_combo(combo, prefix, &out->mods, &out->sym))
+      return false;
+
+   out->action = actions[a].action;
+   out->needs_view = actions[a].needs_view;
+   out->arg = 0;
+
+   if (actions[a].takes_arg) {
+      char *end;
+      unsigned long index;
+      if (!arg || !(index = strtoul(arg, &end, 10)) || *end || index > UINT32_MAX)
+         return false;
+      out->arg = index - 1;
+   } else if (arg) {
+      return false;
+   }
+
+   return !strtok_r(NULL, sep, &save);
+}
+
+static bool
+read_file(struct list *list, const char *path, uint32_t prefix)
+{
+   FILE *f;
+   if (!(f = fopen(path, "r")))
+      return true;
+
+   char line[256];
+   bool ok = true;
+   for (uint32_t n = 1; ok && fgets(line, sizeof(line), f); ++n) {
+      char *s = line;
+      while (isspace((unsigned char)*s))
+         ++s;
+
+      if (!*s || *s == '#')
+         continue;
+
+      struct binding b;
+      if (!parse_line(s, prefix, &b)) {
+         wlc_log(WLC_LOG_WARN, "%s:%u: bad binding, skipped", path, n);
+         continue;
+      }
+
+      ok = push(list, &b);
+   }
+
+   fclose(f);
+   return ok;
+}
+
+static bool
+default_path(char *buf, size_t size)
+{
+   const char *dir;
+   if ((dir = getenv("XDG_CONFIG_HOME")) && *dir)
+      return (snprintf(buf, size, "%s/loliwm/bindings", dir) < (int)size);
+   if ((dir = getenv("HOME")) && *dir)
+      return (snprintf(buf, size, "%s/.config/loliwm/bindings", dir) < (int)size);
+   return false;
+}
+
+static bool
+add_defaults(struct list *list, uint32_t prefix)
+{
+   for (uint32_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); ++i) {
+      const int a = action_index(defaults[i].action);
+      const struct binding b = { prefix, defaults[i].sym, defaults[i].action, defaults[i].arg, actions[a].needs_view };
+      if (!push(list, &b))
+         return false;
+   }
+
+   // mod-1..9,0 focus spaces 1..10, mod-F1..F10 move the focused view there.
+   for (uint32_t i = 0; i < 10; ++i) {
+      const struct binding focus = { prefix, (i == 9 ? XKB_KEY_0 : XKB_KEY_1 + i), ACTION_FOCUS_SPACE, i, false };
+      const struct binding move = { prefix, XKB_KEY_F1 + i, ACTION_MOVE_TO_SPACE, i, true };
+      if (!push(list, &focus) || !push(list, &move))
+         return false;
+   }
+
+   return true;
+}
+
+bool
+bindings_load(const char *path, uint32_t prefix)
+{
+   char buf[PATH_MAX];
+   if (!path && default_path(buf, sizeof(buf)))
+      path = buf;
+
+   struct list list = { NULL, 0, 0 };
+   if (!add_defaults(&list, prefix) || (path && !read_file(&list, path, prefix))) {
+      free(list.items);
+      return false;
+   }
+
+   uint32_t capacity = 64;
+   while (capacity < list.memb * 2)
+      capacity *= 2;
+
+   struct binding *slots;
+   if (!(slots = calloc(capacity, sizeof(struct binding)))) {
+      free(list.items);
+      return false;
+   }
+
+   for (uint32_t i = 0; i < list.memb; ++i)
+      slots[find_slot(slots, capacity, list.items[i].mods, list.items[i].sym)] = list.items[i];
+
+   free(list.items);
+   free(map.slots);
+   map.slots = slots;
+   map.capacity = capacity;
+   return true;
+}
+
+const struct binding*
+bindings_find(uint32_t mods, uint32_t sym)
+{
+   if (!map.slots || !sym)
+      return NULL;
+
+   const struct binding *b = &map.slots[find_slot(map.slots, map.capacity, mods, unshifted(mods, sym))];
+   return (b->sym && b->action != ACTION_NONE ? b : NULL);
+}
+
+void
+bindings_release(void)
+{
+   free(map.slots);
+   memset(&map, 0, sizeof(map));
+}
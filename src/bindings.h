@@ -0,0 +1,63 @@
+#ifndef loliwm_bindings
+#define loliwm_bindings
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Key bindings, looked up by (modifier mask, keysym).
+// Defaults come from config.h, a config file can add to and override them:
+//
+//    # key          action            argument
+//    mod+Return     terminal
+//    mod+shift+q    close
+//    mod+F1         move-to-space     1
+//    mod+r          none
+//
+// "mod" is the --prefix modifier, "none" removes a binding.
+// With shift letters match lowercase, mod+shift+q and mod+shift+Q are the same. Other
+// shifted keys are named as shifted, mod+shift+exclam rather than mod+shift+1.
+
+enum action {
+   ACTION_NONE,
+   ACTION_EXIT,
+   ACTION_CLOSE,
+   ACTION_TERMINAL,
+   ACTION_MENU,
+   ACTION_FULLSCREEN,
+   ACTION_CYCLE,
+   ACTION_NMASTER_EXPAND,
+   ACTION_NMASTER_SHRINK,
+   ACTION_FOCUS_SPACE,
+   ACTION_MOVE_TO_SPACE,
+   ACTION_MOVE_TO_OUTPUT,
+   ACTION_ROTATE_OUTPUT,
+   ACTION_FOCUS_PREVIOUS_VIEW,
+   ACTION_FOCUS_NEXT_VIEW,
+   ACTION_SCREENSHOT,
+   ACTION_SCREENSHOT_VIEW,
+   ACTION_SCREENSHOT_REGION,
+   ACTION_RECORD,
+};
+
+struct binding {
+   uint32_t mods, sym;
+   enum action action;
+
+   // Index for actions that take one, 1 based in the config file, 0 based here.
+   uint32_t arg;
+
+   // Action works on the focused view, key is passed on to clients when there is none.
+   bool needs_view;
+};
+
+// Replaces the bindings with the defaults plus path, NULL reads the default path.
+// A missing file is not an error. Bad lines are logged and skipped.
+// Returns false and keeps the old bindings if memory runs out.
+bool bindings_load(const char *path, uint32_t prefix);
+
+// NULL if nothing is bound to the combination.
+const struct binding* bindings_find(uint32_t mods, uint32_t sym);
+
+void bindings_release(void);
+
+#endif
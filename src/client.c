@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <assert.h>
+#include "client.h"
+#include "pool.h"
+
+// Open addressing with linear probing, removal shifts entries back so there are no tombstones.
+static struct {
+   struct client **slots;
+   uint32_t capacity, memb;
+} map;
+
+static struct pool pool = POOL_INIT(struct client, 64);
+
+static uint32_t
+hash(struct wlc_view *view)
+{
+   uint64_t h = (uintptr_t)view;
+   h ^= h >> 33;
+   h *= 0xff51afd7ed558ccdULL;
+   h ^= h >> 33;
+   return (uint32_t)h;
+}
+
+static uint32_t
+find_slot(struct client **slots, uint32_t capacity, struct wlc_view *view)
+{
+   uint32_t mask = capacity - 1, i = hash(view) & mask;
+   while (slots[i] && slots[i]->view != view)
+      i = (i + 1) & mask;
+   return i;
+}
+
+static bool
+grow(void)
+{
+   uint32_t capacity = (map.capacity ? map.capacity * 2 : 64);
+
+   struct client **slots;
+   if (!(slots = calloc(capacity, sizeof(struct client*))))
+      return false;
+
+   for (uint32_t i = 0; i < map.capacity; ++i) {
+      if (map.slots[i])
+         slots[find_slot(slots, capacity, map.slots[i]->view)] = map.slots[i];
+   }
+
+   free(map.slots);
+   map.slots = slots;
+   map.capacity = capacity;
+   return true;
+}
+
+struct client*
+client_for_view(struct wlc_view *view)
+{
+   if (!view || !map.memb)
+      return NULL;
+
+   return map.slots[find_slot(map.slots, map.capacity, view)];
+}
+
+struct client*
+client_add(struct wlc_view *view)
+{
+   assert(view);
+
+   struct client *c;
+   if ((c = client_for_view(view)))
+      return c;
+
+   // Keep load factor under 0.5
+   if ((map.memb + 1) * 2 > map.capacity && !grow())
+      return NULL;
+
+   if (!(c = pool_alloc(&pool)))
+      return NULL;
+
+   c->view = view;
+   c->root = c;
+   wl_list_init(&c->tiled_link);
+   wl_list_init(&c->fullscreen_link);
+   wl_list_init(&c->focus_link);
+   wl_list_init(&c->children);
+   wl_list_init(&c->child_link);
+   map.slots[find_slot(map.slots, map.capacity, view)] = c;
+   map.memb++;
+   return c;
+}
+
+void
+client_remove(struct wlc_view *view)
+{
+   if (!view || !map.memb)
+      return;
+
+   uint32_t mask = map.capacity - 1, i = find_slot(map.slots, map.capacity, view);
+   if (!map.slots[i])
+      return;
+
+   // Orphan the children, wlc does the same for the views.
+   struct client *c = map.slots[i], *child, *cn;
+   wl_list_for_each_safe(child, cn, &c->children, child_link)
+      client_set_parent(child, NULL);
+
+   client_set_parent(c, NULL);
+   pool_free(&pool, c);
+   map.slots[i] = NULL;
+   map.memb--;
+
+   // Shift back the rest of the cluster so lookups do not stop early.
+   for (uint32_t j = (i + 1) & mask; map.slots[j]; j = (j + 1) & mask) {
+      uint32_t k = hash(map.slots[j]->view) & mask;
+      if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+         map.slots[i] = map.slots[j];
+         map.slots[j] = NULL;
+         i = j;
+      }
+   }
+}
+
+static void
+reroot(struct client *c)
+{
+   // Dialog trees are shallow and reparenting is rare, layout reads the result far more often.
+   c->root = (c->parent ? c->parent->root : c);
+   c->depth = (c->parent ? c->parent->depth + 1 : 0);
+   c->dialog.valid = false;
+
+   struct client *child;
+   wl_list_for_each(child, &c->children, child_link)
+      reroot(child);
+}
+
+void
+client_set_parent(struct client *c, struct client *parent)
+{
+   assert(c && c != parent);
+
+   wl_list_remove(&c->child_link);
+   wl_list_init(&c->child_link);
+
+   if ((c->parent = parent))
+      wl_list_insert(parent->children.prev, &c->child_link);
+
+   reroot(c);
+   client_classify(c);
+}
+
+void
+client_set_state(struct client *c, uint32_t state, bool toggle)
+{
+   assert(c);
+   c->state = (toggle ? c->state | state : c->state & ~state);
+   client_classify(c);
+}
+
+void
+client_classify(struct client *c)
+{
+   assert(c);
+
+   c->flags = 0;
+
+   if (!(c->type & (WLC_BIT_UNMANAGED | WLC_BIT_POPUP | WLC_BIT_SPLASH)))
+      c->flags |= CLIENT_MANAGED;
+
+   if ((c->type & WLC_BIT_OVERRIDE_REDIRECT) || (c->state & BIT_BEMENU))
+      c->flags |= CLIENT_OR;
+
+   if ((c->flags & CLIENT_MANAGED) && !(c->flags & CLIENT_OR) && !(c->type & WLC_BIT_MODAL) && !(c->state & WLC_BIT_FULLSCREEN) && !c->parent)
+      c->flags |= CLIENT_TILEABLE;
+}
+
+void
+client_raise(struct client *c)
+{
+   assert(c);
+
+   if (!c->parent)
+      return;
+
+   wl_list_remove(&c->child_link);
+   wl_list_insert(c->parent->children.prev, &c->child_link);
+}
+
+void
+client_release(void)
+{
+   pool_release(&pool);
+   free(map.slots);
+   map.slots = NULL;
+   map.capacity = map.memb = 0;
+}
@@ -0,0 +1,83 @@
+#ifndef loliwm_client
+#define loliwm_client
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <wlc.h>
+#include <wayland-util.h>
+
+struct space;
+
+// XXX: hack, bemenu is marked with a state bit wlc does not use.
+enum {
+   BIT_BEMENU = 1<<5,
+};
+
+enum client_flag {
+   CLIENT_MANAGED = 1<<0, // not unmanaged, popup or splash
+   CLIENT_OR = 1<<1, // override redirect or bemenu
+   CLIENT_TILEABLE = 1<<2, // managed top level that is not or, modal or fullscreen
+};
+
+// Per view bookkeeping that wlc does not keep for us.
+// Clients are found by their wlc_view through a hash map, wlc_view is only used as a key here.
+// Clients and spaces come from pools, so view churn does not hit malloc.
+
+struct client {
+   struct wlc_view *view;
+
+   // Copies of wlc_view type and state, loliwm is the only one changing them after creation.
+   // flags are derived from them and the parent, see client_classify().
+   uint32_t type, state, flags;
+
+   // Space the view is listed on, and its link in space.tiled when tiled.
+   struct space *space;
+   struct wl_list tiled_link;
+   bool tiled;
+
+   // Link in space.fullscreen when fullscreen.
+   struct wl_list fullscreen_link;
+   bool fullscreen;
+
+   // Link in space.focus, managed clients only.
+   struct wl_list focus_link;
+
+   // Dialog tree, children are in stacking order with the topmost last.
+   // root is the undermost ancestor (the client itself when it has no parent), depth its distance from it.
+   // Both are kept up to date by client_set_parent() for the whole subtree.
+   struct client *parent, *root;
+   struct wl_list children, child_link;
+   uint32_t depth;
+
+   // Parent and root sizes the dialog was last centered and constrained with.
+   // Layout only recomputes dialogs when one of them changed.
+   struct {
+      struct wlc_size parent, root;
+      bool valid;
+   } dialog;
+
+   // Index of the client in the layout pass that last described it, see apply_layout().
+   uint32_t layout_index;
+
+   // Whether loliwm has configured the view yet, and the maximized state it last pushed to wlc.
+   // Geometry is compared with wlc's own, which the client can change too.
+   struct {
+      bool maximized;
+      bool valid;
+   } commit;
+};
+
+struct client* client_for_view(struct wlc_view *view);
+struct client* client_add(struct wlc_view *view);
+void client_remove(struct wlc_view *view);
+void client_set_parent(struct client *c, struct client *parent);
+
+// Updates the cached state, call along with wlc_view_set_state().
+void client_set_state(struct client *c, uint32_t state, bool toggle);
+
+// Recomputes flags, call after changing type.
+void client_classify(struct client *c);
+void client_raise(struct client *c);
+void client_release(void);
+
+#endif
@@ -12,10 +12,17 @@
 #define MOVE_FOCUS_OUTPUT_ONE XKB_KEY_z
 #define MOVE_FOCUS_OUTPUT_TWO XKB_KEY_x
 #define MOVE_FOCUS_OUTPUT_THREE XKB_KEY_c
+#define MOVE_FOCUS_OUTPUT_FOUR XKB_KEY_v
+#define MOVE_FOCUS_OUTPUT_FIVE XKB_KEY_b
+#define MOVE_FOCUS_OUTPUT_SIX XKB_KEY_n
+#define MOVE_FOCUS_OUTPUT_SEVEN XKB_KEY_m
+#define MOVE_FOCUS_OUTPUT_EIGHT XKB_KEY_comma
 #define ROTATE_OUTPUT_FOCUS_KEY XKB_KEY_l
 #define MOVE_CLIENT_FOCUS_LEFT XKB_KEY_j
 #define MOVE_CLIENT_FOCUS_RIGHT XKB_KEY_k
 #define SCREENSHOT_KEY XKB_KEY_SunPrint_Screen //This is what i mean by this.
+#define SCREENSHOT_VIEW_KEY XKB_KEY_s
+#define SCREENSHOT_REGION_KEY XKB_KEY_a
 /* 
   This does not work with --prefix alt, because on linux you use sysrq by
   doing alt+printscreen+[insert sysrq command key here], and therfore
@@ -26,6 +33,41 @@
   (ignore this if running bsd, mach, etc...)
 */
 
+// Focus follows mouse once pointer has stayed this long on a view,
+// and is at least this many pixels inside of it.
+#define FOCUS_DWELL_MS 40
+#define FOCUS_HYSTERESIS 4
+
+// Interactive move and resize apply the latest geometry request DRAG_FPS
+// times a second, the ones in between are dropped.
+// wlc does not tell the refresh rate of outputs, so this stands in for it.
+#define DRAG_FPS 60
+
+// Screenshots waiting to be written, more are dropped.
+#define SCREENSHOT_QUEUE_MAX 4
+
+// zlib level for PNG screenshots, low levels keep them quick.
+#define SCREENSHOT_PNG_LEVEL 3
+
+// Toggles recording of the focused output to a Y4M file.
+// Frames are read back RECORD_FPS times a second, at most RECORD_SLOTS
+// of them wait for the writer, more are dropped.
+#define RECORD_TOGGLE_KEY XKB_KEY_r
+#define RECORD_FPS 30
+#define RECORD_SLOTS 8
+
+// Trace ring keeps the last TRACE_RING_SIZE (power of two) messages, longer ones are cut.
+// --trace streams it to a file every TRACE_DRAIN_MS.
+#define TRACE_DEFAULT_LEVEL TRACE_INFO
+#define TRACE_RING_SIZE 4096
+#define TRACE_MESSAGE_MAX 112
+#define TRACE_DRAIN_MS 100
+
+// Terminals launched by loliwm that have not mapped this long are given up on,
+// at most TERMINAL_STARTING_MAX are waited for at once.
+#define TERMINAL_START_TIMEOUT_MS 5000
+#define TERMINAL_STARTING_MAX 8
+
 #define DEFAULT_TERM "weston-terminal"
 #define MENU_APP "bemenu-run"
 #endif
@@ -0,0 +1,331 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "encode.h"
+#include "config.h"
+
+static const char *names[] = {
+   [ENCODE_PPM] = "ppm",
+   [ENCODE_QOI] = "qoi",
+   [ENCODE_PNG] = "png",
+};
+
+bool
+encode_format_from_name(const char *name, enum encode_format *format)
+{
+   for (uint32_t i = 0; name && i < sizeof(names) / sizeof(names[0]); ++i) {
+      if (strcmp(names[i], name))
+         continue;
+
+      *format = i;
+      return true;
+   }
+   return false;
+}
+
+const char*
+encode_format_name(enum encode_format format)
+{
+   return names[format];
+}
+
+static void
+put_be32(uint8_t *dst, uint32_t v)
+{
+   dst[0] = v >> 24;
+   dst[1] = v >> 16;
+   dst[2] = v >> 8;
+   dst[3] = v;
+}
+
+bool
+encode_ppm(FILE *f, const uint8_t *rgb, uint32_t w, uint32_t h)
+{
+   fprintf(f, "P6\n%d %d\n255\n", w, h);
+   return (fwrite(rgb, 1, (size_t)w * h * 3, f) == (size_t)w * h * 3);
+}
+
+bool
+encode_qoi(FILE *f, const uint8_t *rgb, uint32_t w, uint32_t h)
+{
+   // https://qoiformat.org/qoi-specification.pdf
+   enum {
+      QOI_OP_INDEX = 0x00,
+      QOI_OP_DIFF = 0x40,
+      QOI_OP_LUMA = 0x80,
+      QOI_OP_RUN = 0xc0,
+      QOI_OP_RGB = 0xfe,
+   };
+
+   const size_t memb = (size_t)w * h;
+
+   // Worst case every pixel is a QOI_OP_RGB
+   uint8_t *out;
+   if (!(out = malloc(14 + memb * 4 + 8)))
+      return false;
+
+   size_t o = 0;
+   memcpy(out, "qoif", 4);
+   put_be32(out + 4, w);
+   put_be32(out + 8, h);
+   out[12] = 3; // channels
+   out[13] = 0; // sRGB
+   o = 14;
+
+   uint32_t index[64] = { 0 }, prev = 0xff000000, run = 0;
+   for (size_t i = 0; i < memb; ++i, rgb += 3) {
+      const uint32_t px = rgb[0] | rgb[1] << 8 | rgb[2] << 16 | 0xff000000;
+
+      if (px == prev) {
+         if (++run == 62 || i + 1 == memb) {
+            out[o++] = QOI_OP_RUN | (run - 1);
+            run = 0;
+         }
+         continue;
+      }
+
+      if (run > 0) {
+         out[o++] = QOI_OP_RUN | (run - 1);
+         run = 0;
+      }
+
+      const uint32_t hash = (rgb[0] * 3 + rgb[1] * 5 + rgb[2] * 7 + 255 * 11) % 64;
+      if (index[hash] == px) {
+         out[o++] = QOI_OP_INDEX | hash;
+      } else {
+         index[hash] = px;
+
+         const int8_t dr = rgb[0] - (uint8_t)prev, dg = rgb[1] - (uint8_t)(prev >> 8), db = rgb[2] - (uint8_t)(prev >> 16);
+         const int8_t dr_dg = dr - dg, db_dg = db - dg;
+
+         if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2) {
+            out[o++] = QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+         } else if (dg > -33 && dg < 32 && dr_dg > -9 && dr_dg < 8 && db_dg > -9 && db_dg < 8) {
+            out[o++] = QOI_OP_LUMA | (dg + 32);
+            out[o++] = (dr_dg + 8) << 4 | (db_dg + 8);
+         } else {
+            out[o++] = QOI_OP_RGB;
+            out[o++] = rgb[0];
+            out[o++] = rgb[1];
+            out[o++] = rgb[2];
+         }
+      }
+
+      prev = px;
+   }
+
+   static const uint8_t padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+   memcpy(out + o, padding, sizeof(padding));
+   o += sizeof(padding);
+
+   const bool ret = (fwrite(out, 1, o, f) == o);
+   free(out);
+   return ret;
+}
+
+struct band {
+   const uint8_t *rgb;
+   uint32_t w, y, rows;
+   bool last, ok;
+
+   // Raw deflate data and adler32 of the filtered rows it was made from.
+   uint8_t *data;
+   size_t size, filtered_size;
+   uLong adler;
+};
+
+static void
+filter_row(uint8_t *dst, const uint8_t *row, const uint8_t *up, uint32_t stride)
+{
+   // Pick None, Sub or Up, whichever has the smallest sum of absolute differences.
+   uint64_t none = 0, sub = 0, vert = 0;
+   for (uint32_t i = 0; i < stride; ++i) {
+      none += (int8_t)row[i] < 0 ? -(int8_t)row[i] : (int8_t)row[i];
+      const int8_t s = row[i] - (i >= 3 ? row[i - 3] : 0);
+      sub += (s < 0 ? -s : s);
+      const int8_t u = row[i] - (up ? up[i] : 0);
+      vert += (u < 0 ? -u : u);
+   }
+
+   if (none <= sub && none <= vert) {
+      dst[0] = 0;
+      memcpy(dst + 1, row, stride);
+   } else if (sub <= vert) {
+      dst[0] = 1;
+      for (uint32_t i = 0; i < stride; ++i)
+         dst[1 + i] = row[i] - (i >= 3 ? row[i - 3] : 0);
+   } else {
+      dst[0] = 2;
+      for (uint32_t i = 0; i < stride; ++i)
+         dst[1 + i] = row[i] - (up ? up[i] : 0);
+   }
+}
+
+static void*
+deflate_band(void *arg)
+{
+   struct band *b = arg;
+   const uint32_t stride = b->w * 3;
+   b->filtered_size = (size_t)b->rows * (stride + 1);
+
+   uint8_t *filtered;
+   if (!(filtered = malloc(b->filtered_size)))
+      return NULL;
+
+   // Filters only look at the row above, which is there in the source image for the first row of band too.
+   for (uint32_t r = 0; r < b->rows; ++r) {
+      const uint32_t y = b->y + r;
+      filter_row(filtered + (size_t)r * (stride + 1), b->rgb + (size_t)y * stride, (y > 0 ? b->rgb + (size_t)(y - 1) * stride : NULL), stride);
+   }
+
+   b->adler = adler32(adler32(0, NULL, 0), filtered, b->filtered_size);
+
+   z_stream zs;
+   memset(&zs, 0, sizeof(zs));
+   if (deflateInit2(&zs, SCREENSHOT_PNG_LEVEL, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      free(filtered);
+      return NULL;
+   }
+
+   // Sync flush ends the band on a byte boundary without a final block, so bands can be concatenated.
+   const size_t bound = deflateBound(&zs, b->filtered_size) + 16;
+   if ((b->data = malloc(bound))) {
+      zs.next_in = filtered;
+      zs.avail_in = b->filtered_size;
+      zs.next_out = b->data;
+      zs.avail_out = bound;
+      const int ret = deflate(&zs, (b->last ? Z_FINISH : Z_SYNC_FLUSH));
+      b->size = bound - zs.avail_out;
+      b->ok = (zs.avail_in == 0 && (b->last ? ret == Z_STREAM_END : ret == Z_OK));
+   }
+
+   deflateEnd(&zs);
+   free(filtered);
+   return NULL;
+}
+
+static bool
+write_chunk(FILE *f, const char type[4], const uint8_t *a, size_t alen, const uint8_t *b, size_t blen, const uint8_t *c, size_t clen)
+{
+   uint8_t head[8];
+   put_be32(head, alen + blen + clen);
+   memcpy(head + 4, type, 4);
+
+   // crc32() resets on NULL buffer, skip the empty parts.
+   uLong crc = crc32(0, NULL, 0);
+   crc = crc32(crc, head + 4, 4);
+   crc = (alen ? crc32(crc, a, alen) : crc);
+   crc = (blen ? crc32(crc, b, blen) : crc);
+   crc = (clen ? crc32(crc, c, clen) : crc);
+
+   uint8_t tail[4];
+   put_be32(tail, crc);
+
+   return (fwrite(head, 1, 8, f) == 8 &&
+           (!alen || fwrite(a, 1, alen, f) == alen) &&
+           (!blen || fwrite(b, 1, blen, f) == blen) &&
+           (!clen || fwrite(c, 1, clen, f) == clen) &&
+           fwrite(tail, 1, 4, f) == 4);
+}
+
+bool
+encode_png(FILE *f, const uint8_t *rgb, uint32_t w, uint32_t h, uint32_t threads)
+{
+   if (!threads) {
+      long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+      threads = (cpus > 0 ? cpus : 1);
+   }
+
+   // Bands of at least 32 rows, smaller ones compress badly.
+   uint32_t memb = (threads > 16 ? 16 : threads);
+   if (memb > h / 32)
+      memb = (h / 32 ? h / 32 : 1);
+
+   struct band *bands;
+   if (!(bands = calloc(memb, sizeof(struct band))))
+      return false;
+
+   for (uint32_t i = 0, y = 0; i < memb; ++i) {
+      bands[i] = (struct band){ .rgb = rgb, .w = w, .y = y, .rows = h / memb + (i < h % memb), .last = (i + 1 == memb) };
+      y += bands[i].rows;
+   }
+
+   pthread_t *workers = NULL;
+   bool *started = NULL;
+   if (!(workers = calloc(memb, sizeof(pthread_t))) || !(started = calloc(memb, sizeof(bool)))) {
+      free(workers);
+      free(bands);
+      return false;
+   }
+
+   for (uint32_t i = 1; i < memb; ++i)
+      started[i] = (pthread_create(&workers[i], NULL, deflate_band, &bands[i]) == 0);
+
+   deflate_band(&bands[0]);
+
+   for (uint32_t i = 1; i < memb; ++i) {
+      if (started[i]) {
+         pthread_join(workers[i], NULL);
+      } else {
+         deflate_band(&bands[i]);
+      }
+   }
+
+   bool ok = true;
+   uLong adler = adler32(0, NULL, 0);
+   for (uint32_t i = 0; i < memb; ++i) {
+      ok = ok && bands[i].ok;
+      adler = adler32_combine(adler, bands[i].adler, bands[i].filtered_size);
+   }
+
+   if (ok) {
+      static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+      static const uint8_t zlib_header[2] = { 0x78, 0x9c };
+
+      uint8_t ihdr[13];
+      put_be32(ihdr, w);
+      put_be32(ihdr + 4, h);
+      ihdr[8] = 8; // bit depth
+      ihdr[9] = 2; // truecolor
+      ihdr[10] = ihdr[11] = ihdr[12] = 0; // deflate, adaptive filtering, no interlace
+
+      uint8_t trailer[4];
+      put_be32(trailer, adler);
+
+      ok = (fwrite(signature, 1, sizeof(signature), f) == sizeof(signature) && write_chunk(f, "IHDR", ihdr, sizeof(ihdr), NULL, 0, NULL, 0));
+
+      // One IDAT per band, the zlib stream continues over them.
+      for (uint32_t i = 0; ok && i < memb; ++i) {
+         ok = write_chunk(f, "IDAT",
+               (i == 0 ? zlib_header : NULL), (i == 0 ? sizeof(zlib_header) : 0),
+               bands[i].data, bands[i].size,
+               (bands[i].last ? trailer : NULL), (bands[i].last ? sizeof(trailer) : 0));
+      }
+
+      ok = ok && write_chunk(f, "IEND", NULL, 0, NULL, 0, NULL, 0);
+   }
+
+   for (uint32_t i = 0; i < memb; ++i)
+      free(bands[i].data);
+
+   free(started);
+   free(workers);
+   free(bands);
+   return ok;
+}
+
+bool
+encode(enum encode_format format, FILE *f, const uint8_t *rgb, uint32_t w, uint32_t h)
+{
+   switch (format) {
+      case ENCODE_QOI:
+         return encode_qoi(f, rgb, w, h);
+      case ENCODE_PNG:
+         return encode_png(f, rgb, w, h, 0);
+      default:break;
+   }
+
+   return encode_ppm(f, rgb, w, h);
+}
@@ -0,0 +1,28 @@
+#ifndef loliwm_encode
+#define loliwm_encode
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Image encoders for screenshots, they take top-down packed RGB.
+
+enum encode_format {
+   ENCODE_PPM,
+   ENCODE_QOI,
+   ENCODE_PNG,
+};
+
+// Returns false and leaves format untouched if name is not known.
+bool encode_format_from_name(const char *name, enum encode_format *format);
+const char* encode_format_name(enum encode_format format);
+
+bool encode_ppm(FILE *f, const uint8_t *rgb, uint32_t w, uint32_t h);
+bool encode_qoi(FILE *f, const uint8_t *rgb, uint32_t w, uint32_t h);
+
+// Deflate is split in row bands over threads, 0 threads uses one per online CPU.
+bool encode_png(FILE *f, const uint8_t *rgb, uint32_t w, uint32_t h, uint32_t threads);
+
+bool encode(enum encode_format format, FILE *f, const uint8_t *rgb, uint32_t w, uint32_t h);
+
+#endif
@@ -0,0 +1,472 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wayland-util.h>
+#include "journal.h"
+
+static const char magic[8] = { 'l', 'o', 'l', 'i', 'j', 'r', 'n', '1' };
+
+static const char *names[JOURNAL_LAST] = {
+   [JOURNAL_VIEW_CREATED] = "view.created",
+   [JOURNAL_VIEW_DESTROYED] = "view.destroyed",
+   [JOURNAL_VIEW_SWITCH_SPACE] = "view.switch_space",
+   [JOURNAL_VIEW_GEOMETRY_REQUEST] = "view.request.geometry",
+   [JOURNAL_VIEW_STATE_REQUEST] = "view.request.state",
+   [JOURNAL_POINTER_MOTION] = "pointer.motion",
+   [JOURNAL_KEYBOARD_KEY] = "keyboard.key",
+   [JOURNAL_OUTPUT_CREATED] = "output.created",
+   [JOURNAL_OUTPUT_ACTIVATED] = "output.activated",
+   [JOURNAL_OUTPUT_RESOLUTION] = "output.resolution",
+   [JOURNAL_SPACE_ACTIVATED] = "space.activated",
+   [JOURNAL_OUTPUT_DESTROYED] = "output.destroyed",
+};
+
+bool journal_active;
+
+// Views and outputs to their journal number.
+// Open addressing with linear probing, removal shifts entries back so there are no tombstones.
+struct id {
+   const void *key;
+   uint32_t id;
+};
+
+static struct {
+   FILE *file;
+   uint64_t last_us;
+   uint32_t next_id;
+
+   struct id *slots;
+   uint32_t capacity, memb;
+
+   // Record being built, largest one is a view with its class.
+   uint8_t buf[256];
+   uint32_t len;
+} journal;
+
+static uint32_t
+hash(const void *key)
+{
+   uint64_t h = (uintptr_t)key;
+   h ^= h >> 33;
+   h *= 0xff51afd7ed558ccdULL;
+   h ^= h >> 33;
+   return (uint32_t)h;
+}
+
+static uint32_t
+find_slot(struct id *slots, uint32_t capacity, const void *key)
+{
+   uint32_t mask = capacity - 1, i = hash(key) & mask;
+   while (slots[i].key && slots[i].key != key)
+      i = (i + 1) & mask;
+   return i;
+}
+
+static bool
+grow(void)
+{
+   uint32_t capacity = (journal.capacity ? journal.capacity * 2 : 64);
+
+   struct id *slots;
+   if (!(slots = calloc(capacity, sizeof(struct id))))
+      return false;
+
+   for (uint32_t i = 0; i < journal.capacity; ++i) {
+      if (journal.slots[i].key)
+         slots[find_slot(slots, capacity, journal.slots[i].key)] = journal.slots[i];
+   }
+
+   free(journal.slots);
+   journal.slots = slots;
+   journal.capacity = capacity;
+   return true;
+}
+
+static uint32_t
+id_for(const void *key)
+{
+   if (!key)
+      return 0;
+
+   if ((journal.memb + 1) * 4 > journal.capacity * 3 && !grow())
+      return 0;
+
+   struct id *slot = &journal.slots[find_slot(journal.slots, journal.capacity, key)];
+   if (!slot->key) {
+      *slot = (struct id){ key, ++journal.next_id };
+      journal.memb++;
+   }
+
+   return slot->id;
+}
+
+static void
+forget(const void *key)
+{
+   if (!key || !journal.memb)
+      return;
+
+   uint32_t mask = journal.capacity - 1, i = find_slot(journal.slots, journal.capacity, key);
+   if (!journal.slots[i].key)
+      return;
+
+   journal.slots[i].key = NULL;
+   journal.memb--;
+
+   for (uint32_t j = (i + 1) & mask; journal.slots[j].key; j = (j + 1) & mask) {
+      const uint32_t home = hash(journal.slots[j].key) & mask;
+      if (((j - home) & mask) >= ((j - i) & mask)) {
+         journal.slots[i] = journal.slots[j];
+         journal.slots[j].key = NULL;
+         i = j;
+      }
+   }
+}
+
+static void
+put(uint64_t v)
+{
+   do {
+      journal.buf[journal.len++] = (v & 0x7f) | (v > 0x7f ? 0x80 : 0);
+      v >>= 7;
+   } while (v);
+}
+
+static void
+put_signed(int64_t v)
+{
+   put(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void
+begin(enum journal_type type)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   const uint64_t now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+   journal.len = 0;
+   journal.buf[journal.len++] = type;
+   put(journal.last_us ? now - journal.last_us : 0);
+   journal.last_us = now;
+}
+
+static void
+end(void)
+{
+   if (fwrite(journal.buf, 1, journal.len, journal.file) != journal.len) {
+      wlc_log(WLC_LOG_WARN, "journal could not be written, stopped");
+      journal_close();
+   }
+}
+
+static void
+put_space(struct wlc_space *space)
+{
+   uint32_t index = 0;
+   struct wlc_space *s;
+   struct wlc_output *output = (space ? wlc_space_get_output(space) : NULL);
+   if (output) {
+      wlc_space_for_each(s, wlc_output_get_spaces(output)) {
+         if (s == space)
+            break;
+         ++index;
+      }
+   }
+
+   put(id_for(output));
+   put(index);
+}
+
+static void
+put_geometry(const struct wlc_geometry *g)
+{
+   put_signed(g->origin.x);
+   put_signed(g->origin.y);
+   put(g->size.w);
+   put(g->size.h);
+}
+
+bool
+journal_open(const char *path)
+{
+   if (journal.file || !(journal.file = fopen(path, "wb")))
+      return false;
+
+   // Callbacks come in bursts, keep them off the disk until the buffer fills.
+   setvbuf(journal.file, NULL, _IOFBF, 1 << 16);
+
+   if (fwrite(magic, 1, sizeof(magic), journal.file) != sizeof(magic)) {
+      fclose(journal.file);
+      journal.file = NULL;
+      return false;
+   }
+
+   journal_active = true;
+   return true;
+}
+
+void
+journal_close(void)
+{
+   journal_active = false;
+
+   if (journal.file)
+      fclose(journal.file);
+
+   free(journal.slots);
+   memset(&journal, 0, sizeof(journal));
+}
+
+void
+journal_view_created(struct wlc_compositor *compositor, struct wlc_view *view, struct wlc_space *space)
+{
+   (void)compositor;
+
+   const char *class = wlc_view_get_class(view);
+   const size_t len = (class ? strnlen(class, sizeof(((struct journal_event*)0)->class) - 1) : 0);
+
+   begin(JOURNAL_VIEW_CREATED);
+   put(id_for(view));
+   put_space(space);
+   put(id_for(wlc_view_get_parent(view)));
+   put(wlc_view_get_type(view));
+   put(wlc_view_get_state(view));
+   put_geometry(wlc_view_get_geometry(view));
+   put(len);
+   memcpy(journal.buf + journal.len, class, len);
+   journal.len += len;
+   end();
+}
+
+void
+journal_view_destroyed(struct wlc_compositor *compositor, struct wlc_view *view)
+{
+   (void)compositor;
+   begin(JOURNAL_VIEW_DESTROYED);
+   put(id_for(view));
+   end();
+   forget(view);
+}
+
+void
+journal_view_switch_space(struct wlc_compositor *compositor, struct wlc_view *view, struct wlc_space *from, struct wlc_space *to)
+{
+   (void)compositor;
+   begin(JOURNAL_VIEW_SWITCH_SPACE);
+   put(id_for(view));
+   put_space(from);
+   put_space(to);
+   end();
+}
+
+void
+journal_view_geometry_request(struct wlc_compositor *compositor, struct wlc_view *view, const struct wlc_geometry *geometry)
+{
+   (void)compositor;
+   begin(JOURNAL_VIEW_GEOMETRY_REQUEST);
+   put(id_for(view));
+   put_geometry(geometry);
+   end();
+}
+
+void
+journal_view_state_request(struct wlc_compositor *compositor, struct wlc_view *view, const enum wlc_view_state_bit state, const bool toggle)
+{
+   (void)compositor;
+   begin(JOURNAL_VIEW_STATE_REQUEST);
+   put(id_for(view));
+   put(state);
+   put(toggle);
+   end();
+}
+
+void
+journal_pointer_motion(struct wlc_compositor *compositor, struct wlc_view *view, uint32_t time, const struct wlc_origin *origin)
+{
+   (void)compositor;
+   begin(JOURNAL_POINTER_MOTION);
+   put(id_for(view));
+   put(time);
+   put_signed(origin->x);
+   put_signed(origin->y);
+   end();
+}
+
+void
+journal_keyboard_key(struct wlc_compositor *compositor, struct wlc_view *view, uint32_t time, const struct wlc_modifiers *modifiers, uint32_t key, uint32_t sym, enum wlc_key_state state)
+{
+   (void)compositor;
+   begin(JOURNAL_KEYBOARD_KEY);
+   put(id_for(view));
+   put(time);
+   put(modifiers->leds);
+   put(modifiers->mods);
+   put(key);
+   put(sym);
+   put(state);
+   end();
+}
+
+void
+journal_output_created(struct wlc_compositor *compositor, struct wlc_output *output)
+{
+   (void)compositor;
+   const struct wlc_size *resolution = wlc_output_get_resolution(output);
+   begin(JOURNAL_OUTPUT_CREATED);
+   put(id_for(output));
+   put(resolution ? resolution->w : 0);
+   put(resolution ? resolution->h : 0);
+   end();
+}
+
+void
+journal_output_destroyed(struct wlc_compositor *compositor, struct wlc_output *output)
+{
+   (void)compositor;
+   begin(JOURNAL_OUTPUT_DESTROYED);
+   put(id_for(output));
+   end();
+   forget(output);
+}
+
+void
+journal_output_notify(struct wlc_compositor *compositor, struct wlc_output *output)
+{
+   (void)compositor;
+   begin(JOURNAL_OUTPUT_ACTIVATED);
+   put(id_for(output));
+   end();
+}
+
+void
+journal_resolution_notify(struct wlc_compositor *compositor, struct wlc_output *output, const struct wlc_size *resolution)
+{
+   (void)compositor;
+   begin(JOURNAL_OUTPUT_RESOLUTION);
+   put(id_for(output));
+   put(resolution->w);
+   put(resolution->h);
+   end();
+}
+
+void
+journal_space_notify(struct wlc_compositor *compositor, struct wlc_space *space)
+{
+   (void)compositor;
+   begin(JOURNAL_SPACE_ACTIVATED);
+   put_space(space);
+   end();
+}
+
+bool
+journal_read_header(FILE *f)
+{
+   char buf[sizeof(magic)];
+   return (fread(buf, 1, sizeof(buf), f) == sizeof(buf) && !memcmp(buf, magic, sizeof(magic)));
+}
+
+static bool
+get(FILE *f, uint64_t *v)
+{
+   *v = 0;
+   for (uint32_t shift = 0; shift < 64; shift += 7) {
+      int c;
+      if ((c = fgetc(f)) == EOF)
+         return false;
+
+      *v |= (uint64_t)(c & 0x7f) << shift;
+      if (!(c & 0x80))
+         return true;
+   }
+   return false;
+}
+
+static bool
+get_u32(FILE *f, uint32_t *v)
+{
+   uint64_t u;
+   if (!get(f, &u))
+      return false;
+
+   *v = u;
+   return true;
+}
+
+static bool
+get_i32(FILE *f, int32_t *v)
+{
+   uint64_t u;
+   if (!get(f, &u))
+      return false;
+
+   *v = (int32_t)((u >> 1) ^ -(u & 1));
+   return true;
+}
+
+static bool
+get_space(FILE *f, struct journal_space *space)
+{
+   return get_u32(f, &space->output) && get_u32(f, &space->index);
+}
+
+static bool
+get_geometry(FILE *f, struct wlc_geometry *g)
+{
+   return get_i32(f, &g->origin.x) && get_i32(f, &g->origin.y) && get_u32(f, &g->size.w) && get_u32(f, &g->size.h);
+}
+
+bool
+journal_read(FILE *f, struct journal_event *event)
+{
+   memset(event, 0, sizeof(struct journal_event));
+
+   int type;
+   if ((type = fgetc(f)) == EOF || type <= 0 || type >= JOURNAL_LAST || !get(f, &event->delta_us))
+      return false;
+
+   event->type = type;
+
+   uint32_t toggle, len;
+   switch (event->type) {
+      case JOURNAL_VIEW_CREATED:
+         if (!get_u32(f, &event->view) || !get_space(f, &event->space) || !get_u32(f, &event->parent) ||
+             !get_u32(f, &event->view_type) || !get_u32(f, &event->view_state) || !get_geometry(f, &event->geometry) ||
+             !get_u32(f, &len) || len >= sizeof(event->class) || fread(event->class, 1, len, f) != len)
+            return false;
+         return true;
+      case JOURNAL_VIEW_DESTROYED:
+         return get_u32(f, &event->view);
+      case JOURNAL_VIEW_SWITCH_SPACE:
+         return get_u32(f, &event->view) && get_space(f, &event->space) && get_space(f, &event->to);
+      case JOURNAL_VIEW_GEOMETRY_REQUEST:
+         return get_u32(f, &event->view) && get_geometry(f, &event->geometry);
+      case JOURNAL_VIEW_STATE_REQUEST:
+         if (!get_u32(f, &event->view) || !get_u32(f, &event->state) || !get_u32(f, &toggle))
+            return false;
+         event->toggle = toggle;
+         return true;
+      case JOURNAL_POINTER_MOTION:
+         return get_u32(f, &event->view) && get_u32(f, &event->time) && get_i32(f, &event->origin.x) && get_i32(f, &event->origin.y);
+      case JOURNAL_KEYBOARD_KEY:
+         return get_u32(f, &event->view) && get_u32(f, &event->time) && get_u32(f, &event->modifiers.leds) && get_u32(f, &event->modifiers.mods) &&
+                get_u32(f, &event->key) && get_u32(f, &event->sym) && get_u32(f, &event->key_state);
+      case JOURNAL_OUTPUT_CREATED:
+      case JOURNAL_OUTPUT_RESOLUTION:
+         return get_u32(f, &event->output) && get_u32(f, &event->resolution.w) && get_u32(f, &event->resolution.h);
+      case JOURNAL_OUTPUT_DESTROYED:
+      case JOURNAL_OUTPUT_ACTIVATED:
+         return get_u32(f, &event->output);
+      case JOURNAL_SPACE_ACTIVATED:
+         return get_space(f, &event->space);
+      default:break;
+   }
+
+   return false;
+}
+
+const char*
+journal_type_name(enum journal_type type)
+{
+   return (type > 0 && type < JOURNAL_LAST ? names[type] : "unknown");
+}
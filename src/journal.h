@@ -0,0 +1,88 @@
+#ifndef loliwm_journal
+#define loliwm_journal
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <wlc.h>
+
+// Binary journal of the wlc callbacks loliwm receives, for replaying sessions with loliwm-replay.
+//
+// Records are a type byte followed by varints: time since previous record in microseconds,
+// then the fields of the event. Views and outputs are numbered from 1 in the order they are
+// first seen, 0 meaning none. Spaces are (output, index in the output's space list), they are
+// created by loliwm itself so replay recreates the same ones.
+
+enum journal_type {
+   JOURNAL_VIEW_CREATED = 1,
+   JOURNAL_VIEW_DESTROYED,
+   JOURNAL_VIEW_SWITCH_SPACE,
+   JOURNAL_VIEW_GEOMETRY_REQUEST,
+   JOURNAL_VIEW_STATE_REQUEST,
+   JOURNAL_POINTER_MOTION,
+   JOURNAL_KEYBOARD_KEY,
+   JOURNAL_OUTPUT_CREATED,
+   JOURNAL_OUTPUT_ACTIVATED,
+   JOURNAL_OUTPUT_RESOLUTION,
+   JOURNAL_SPACE_ACTIVATED,
+   JOURNAL_OUTPUT_DESTROYED,
+   JOURNAL_LAST,
+};
+
+struct journal_space {
+   uint32_t output, index;
+};
+
+struct journal_event {
+   enum journal_type type;
+   uint64_t delta_us;
+
+   uint32_t view, output;
+   struct journal_space space, to;
+
+   // view created
+   uint32_t parent, view_type, view_state;
+   char class[64];
+
+   struct wlc_geometry geometry;
+   struct wlc_size resolution;
+
+   // state request
+   uint32_t state;
+   bool toggle;
+
+   // input
+   uint32_t time, key, sym, key_state;
+   struct wlc_modifiers modifiers;
+   struct wlc_origin origin;
+};
+
+extern bool journal_active;
+
+// Starts journaling every callback to path.
+bool journal_open(const char *path);
+void journal_close(void);
+
+// Same arguments as the wlc_interface callbacks.
+void journal_view_created(struct wlc_compositor *compositor, struct wlc_view *view, struct wlc_space *space);
+void journal_view_destroyed(struct wlc_compositor *compositor, struct wlc_view *view);
+void journal_view_switch_space(struct wlc_compositor *compositor, struct wlc_view *view, struct wlc_space *from, struct wlc_space *to);
+void journal_view_geometry_request(struct wlc_compositor *compositor, struct wlc_view *view, const struct wlc_geometry *geometry);
+void journal_view_state_request(struct wlc_compositor *compositor, struct wlc_view *view, const enum wlc_view_state_bit state, const bool toggle);
+void journal_pointer_motion(struct wlc_compositor *compositor, struct wlc_view *view, uint32_t time, const struct wlc_origin *origin);
+void journal_keyboard_key(struct wlc_compositor *compositor, struct wlc_view *view, uint32_t time, const struct wlc_modifiers *modifiers, uint32_t key, uint32_t sym, enum wlc_key_state state);
+void journal_output_created(struct wlc_compositor *compositor, struct wlc_output *output);
+void journal_output_destroyed(struct wlc_compositor *compositor, struct wlc_output *output);
+void journal_output_notify(struct wlc_compositor *compositor, struct wlc_output *output);
+void journal_resolution_notify(struct wlc_compositor *compositor, struct wlc_output *output, const struct wlc_size *resolution);
+void journal_space_notify(struct wlc_compositor *compositor, struct wlc_space *space);
+
+// Checks the header, call once before journal_read.
+bool journal_read_header(FILE *f);
+
+// Returns false at end of journal or if it is corrupt.
+bool journal_read(FILE *f, struct journal_event *event);
+
+const char* journal_type_name(enum journal_type type);
+
+#endif
@@ -0,0 +1,54 @@
+// POSIX_SPAWN_SETSID is a GNU extension in glibc.
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include "launch.h"
+#include "trace.h"
+
+extern char **environ;
+
+pid_t
+launch(const char *bin)
+{
+   posix_spawn_file_actions_t actions;
+   posix_spawnattr_t attr;
+
+   if (posix_spawn_file_actions_init(&actions) != 0)
+      return -1;
+
+   if (posix_spawnattr_init(&attr) != 0) {
+      posix_spawn_file_actions_destroy(&actions);
+      return -1;
+   }
+
+   // Child gets its own session, no blocked signals and default handlers.
+   sigset_t none, all;
+   sigemptyset(&none);
+   sigfillset(&all);
+
+   short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_SETSID
+   flags |= POSIX_SPAWN_SETSID;
+#else
+   flags |= POSIX_SPAWN_SETPGROUP;
+#endif
+
+   pid_t pid = -1;
+   char *argv[] = { (char*)bin, NULL };
+   if (posix_spawnattr_setflags(&attr, flags) == 0 &&
+       posix_spawnattr_setsigmask(&attr, &none) == 0 &&
+       posix_spawnattr_setsigdefault(&attr, &all) == 0 &&
+       posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0) == 0 &&
+       posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0) == 0 &&
+       posix_spawnp(&pid, bin, &actions, &attr, argv, environ) != 0) {
+      trace(TRACE_WARN, "could not spawn %s", bin);
+      pid = -1;
+   }
+
+   posix_spawnattr_destroy(&attr);
+   posix_spawn_file_actions_destroy(&actions);
+   return pid;
+}
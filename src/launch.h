@@ -0,0 +1,11 @@
+#ifndef loliwm_launch
+#define loliwm_launch
+
+#include <sys/types.h>
+
+// Starts bin from PATH in a new session with stdout and stderr on /dev/null.
+// Uses posix_spawn, so the compositor's mappings are never copied.
+// Returns the pid, or -1 if it could not be started.
+pid_t launch(const char *bin);
+
+#endif
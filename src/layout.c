@@ -0,0 +1,82 @@
+#include <math.h>
+#include <assert.h>
+#include "layout.h"
+
+static bool
+size_equals(const struct wlc_size *a, const struct wlc_size *b)
+{
+   return (a->w == b->w && a->h == b->h);
+}
+
+void
+layout_dialog(struct wlc_geometry *out, const struct wlc_size *size, const struct wlc_geometry *parent, const struct wlc_geometry *root)
+{
+   assert(out && size && parent && root);
+
+   // Size to fit the undermost parent
+   // TODO: Use surface height as base instead of current
+
+   // Current constrained size
+   float cw = fmax(size->w, root->size.w * 0.6);
+   float ch = fmax(size->h, root->size.h * 0.6);
+
+   struct wlc_geometry g;
+   g.size.w = fmin(cw, root->size.w * 0.8);
+   g.size.h = fmin(ch, root->size.h * 0.8);
+   g.origin.x = parent->size.w * 0.5 - g.size.w * 0.5;
+   g.origin.y = parent->size.h * 0.5 - g.size.h * 0.5;
+   *out = g;
+}
+
+void
+layout_space(struct layout_item *items, uint32_t memb, const struct wlc_size *resolution, float cut)
+{
+   assert(resolution);
+
+   uint32_t count = 0;
+   for (uint32_t i = 0; i < memb; ++i)
+      if (items[i].kind == LAYOUT_TILED) ++count;
+
+   bool toggle = false;
+   uint32_t y = 0, height = resolution->h / (count > 1 ? count - 1 : 1);
+   uint32_t fheight = (resolution->h > height * (count - 1) ? height + (resolution->h - height * (count - 1)) : height);
+   uint32_t slave = resolution->w * cut;
+
+   for (uint32_t i = 0; i < memb; ++i) {
+      struct layout_item *it = &items[i];
+      switch (it->kind) {
+         case LAYOUT_FULLSCREEN:
+            it->geometry = (struct wlc_geometry){ { 0, 0 }, *resolution };
+         break;
+
+         case LAYOUT_SPLASH:
+            it->geometry.origin = (struct wlc_origin){ resolution->w * 0.5 - it->geometry.size.w * 0.5, resolution->h * 0.5 - it->geometry.size.h * 0.5 };
+         break;
+
+         case LAYOUT_DIALOG:
+            // The dialog already fits its own size, so only a resized parent or root can move it.
+            if ((it->last.kept = (it->last.valid && size_equals(&it->last.parent, &it->parent->size) && size_equals(&it->last.root, &it->root->size))))
+               break;
+
+            layout_dialog(&it->geometry, &it->geometry.size, it->parent, it->root);
+            it->last.parent = it->parent->size;
+            it->last.root = it->root->size;
+            it->last.valid = true;
+         break;
+
+         case LAYOUT_TILED:
+            it->geometry = (struct wlc_geometry){
+               .origin = { (toggle ? resolution->w - slave : 0), y },
+               .size = { (count > 1 ? (toggle ? slave : resolution->w - slave) : resolution->w), (toggle ? (y == 0 ? fheight : height) : resolution->h) },
+            };
+
+            if (toggle)
+               y += (y == 0 ? fheight : height);
+
+            toggle = true;
+         break;
+
+         default:break;
+      }
+   }
+}
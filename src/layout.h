@@ -0,0 +1,40 @@
+#ifndef loliwm_layout
+#define loliwm_layout
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <wlc.h>
+
+// Layout engine is pure, it never talks to wlc.
+// relayout() describes views with layout_items, runs layout_space() and pushes the results.
+
+enum layout_kind {
+   LAYOUT_FLOATING, // geometry is left as is
+   LAYOUT_TILED, // placed in the nmaster layout
+   LAYOUT_FULLSCREEN, // covers the whole output
+   LAYOUT_SPLASH, // centered on the output, size is kept
+   LAYOUT_DIALOG, // centered on parent, constrained by the undermost parent, only redone when either resized
+};
+
+struct layout_item {
+   enum layout_kind kind;
+
+   // Current geometry in, laid out geometry out.
+   struct wlc_geometry geometry;
+
+   // LAYOUT_DIALOG only.
+   // May point to geometry of another item, in that case the item must come earlier in the array.
+   const struct wlc_geometry *parent, *root;
+
+   // LAYOUT_DIALOG only, parent and root sizes the current geometry was laid out with.
+   // When valid and neither changed the dialog is kept as is, otherwise they are updated.
+   struct {
+      struct wlc_size parent, root;
+      bool valid, kept;
+   } last;
+};
+
+void layout_dialog(struct wlc_geometry *out, const struct wlc_size *size, const struct wlc_geometry *parent, const struct wlc_geometry *root);
+void layout_space(struct layout_item *items, uint32_t memb, const struct wlc_size *resolution, float cut);
+
+#endif
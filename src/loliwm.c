@@ -6,86 +6,402 @@
 #include <unistd.h>
 #include <assert.h>
 #include <time.h>
+#include <inttypes.h>
 
 #include <wlc.h>
 #include <wayland-util.h>
+#include <wayland-server.h>
 #include "config.h"
+#include "layout.h"
+#include "client.h"
+#include "space.h"
+#include "screenshot.h"
+#include "record.h"
+#include "bindings.h"
+#include "trace.h"
+#include "launch.h"
+#include "probe.h"
+#include "journal.h"
+
+// Output with its spaces in wlc order, bindings address both by index.
+struct head {
+   struct wlc_output *output;
+   struct wlc_space **spaces;
+   uint32_t memb;
+};
 
-// XXX: hack
-enum {
-   BIT_BEMENU = 1<<5,
+enum focus_fallback {
+   FOCUS_FALLBACK_MRU, // view on the space that had focus most recently
+   FOCUS_FALLBACK_STACKING, // view under the one that went away
 };
 
 static struct {
    struct wlc_view *active;
+
+   // What gets focus when the focused view goes away, or a space or output is shown.
+   enum focus_fallback fallback;
    float cut;
    uint32_t prefix;
+
+   // Bindings file, NULL for the default path.
+   const char *config;
+
+   // Outputs in wlc order, rebuilt when one is created or destroyed.
+   // focused is the head of the last activated output.
+   struct {
+      struct head *items;
+      uint32_t memb, focused;
+   } heads;
+
+   // Scratch space for relayout(), grows as needed.
+   struct {
+      struct layout_item *items;
+      struct wlc_view **views;
+      uint32_t capacity;
+   } layout;
+
+   // Final z-order of a restack, bottom first.
+   struct {
+      struct wlc_view **views;
+      uint32_t memb, capacity;
+   } restack;
+
+   // Focus follows mouse once the pointer settles on a view.
+   struct {
+      struct wlc_compositor *compositor;
+      struct wlc_view *view;
+      struct wl_event_source *timer;
+      uint32_t since, dwell, hysteresis;
+      bool pending;
+   } hover;
+
+   // Geometry requests of an interactive move or resize, at most one is applied per frame.
+   struct {
+      struct wlc_view *view;
+      struct wl_event_source *timer;
+      struct wlc_geometry pending;
+      uint32_t fps;
+      bool armed, has_pending;
+   } drag;
+
+   // Part of the output the next screenshot keeps, and the one from --screenshot-region.
+   struct {
+      struct wlc_geometry pending, region;
+      bool crop, has_region;
+   } capture;
+
+   // Terminals launched with TERM_OPEN_KEY, recognized by their pid or a parent's when they map.
+   // Without LOLIWM_VIEW_PID wlc can not tell the pid, they are recognized by class.
+   // With --prewarm-terminal one is kept started on a hidden space until asked for.
+   struct {
+      struct wlc_space *hidden;
+      struct wlc_view *ready;
+
+      struct {
+         pid_t pid;
+         uint64_t since;
+      } launches[TERMINAL_STARTING_MAX];
+
+      uint64_t pressed;
+      uint32_t starting, wanted;
+      bool prewarm;
+   } terminal;
+
+   // Output being recorded, read back every tick of the timer.
+   // done fires once the writer of a stopped recording has finished.
+   struct {
+      struct wlc_output *output;
+      struct wl_event_source *timer, *done;
+      uint32_t fps;
+   } record;
+
+   // Spaces waiting for relayout, flushed once per event loop iteration.
+   struct wl_list dirty;
+   struct wl_event_source *flush;
+
+   // Callbacks currently running, the ones wlc makes from inside our own wlc calls are nested.
+   uint32_t depth;
+
+   struct {
+      uint64_t configures, configures_skipped, dialogs_kept;
+      uint64_t relayouts, relayouts_coalesced, relayouts_stale;
+      uint64_t restacks, restacks_skipped;
+      uint64_t hover_focus, hover_discarded, hover_ignored;
+      uint64_t drag_applied, drag_dropped;
+      uint64_t terminals_prewarmed, terminals_launched, prewarmed_us, launched_us;
+   } stats;
 } loliwm = {
    .cut = 0.5f,
    .prefix = WLC_BIT_MOD_ALT,
+   .hover = {
+      .dwell = FOCUS_DWELL_MS,
+      .hysteresis = FOCUS_HYSTERESIS,
+   },
+   .drag = {
+      .fps = DRAG_FPS,
+   },
+   .record = {
+      .fps = RECORD_FPS,
+   },
 };
 
+static uint64_t
+now_us(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static struct wl_event_loop*
+event_loop(void)
+{
+   struct wl_display *display;
+   return ((display = wlc_get_wl_display()) ? wl_display_get_event_loop(display) : NULL);
+}
+
+static bool
+geometry_equals(const struct wlc_geometry *a, const struct wlc_geometry *b)
+{
+   return (a->origin.x == b->origin.x && a->origin.y == b->origin.y && a->size.w == b->size.w && a->size.h == b->size.h);
+}
+
+static void
+commit_geometry(struct wlc_view *view, const struct wlc_geometry *g)
+{
+   // Every configure may cost the client a redraw, do not send what it already has.
+   // Compared with what wlc holds, the client or wlc may have changed it since loliwm last did.
+   struct client *c = client_for_view(view);
+   if (c && c->commit.valid && geometry_equals(wlc_view_get_geometry(view), g)) {
+      loliwm.stats.configures_skipped++;
+      return;
+   }
+
+   wlc_view_set_geometry(view, g);
+   loliwm.stats.configures++;
+
+   if (c)
+      c->commit.valid = true;
+}
+
 static void
-layout_parent(struct wlc_view *view, struct wlc_view *parent, const struct wlc_size *size)
+commit_maximized(struct wlc_view *view, bool maximized)
 {
-   assert(view && parent);
+   struct client *c = client_for_view(view);
+   if (c && c->commit.maximized == maximized) {
+      loliwm.stats.configures_skipped++;
+      return;
+   }
 
-   // Size to fit the undermost parent
-   // TODO: Use surface height as base instead of current
-   struct wlc_view *under;
-   for (under = parent; under && wlc_view_get_parent(under); under = wlc_view_get_parent(under));
+   wlc_view_set_state(view, WLC_BIT_MAXIMIZED, maximized);
+   loliwm.stats.configures++;
 
-   // Undermost view and parent view geometry
-   const struct wlc_geometry *u = wlc_view_get_geometry(under);
-   const struct wlc_geometry *p = wlc_view_get_geometry(parent);
+   if (c) {
+      client_set_state(c, WLC_BIT_MAXIMIZED, maximized);
+      c->commit.maximized = maximized;
+   }
+}
+
+static void
+layout_parent(struct client *c, const struct wlc_size *size)
+{
+   assert(c && c->parent);
 
-   // Current constrained size
-   float cw = fmax(size->w, u->size.w * 0.6);
-   float ch = fmax(size->h, u->size.h * 0.6);
+   const struct wlc_geometry *parent = wlc_view_get_geometry(c->parent->view), *root = wlc_view_get_geometry(c->root->view);
 
    struct wlc_geometry g;
-   g.size.w = fmin(cw, u->size.w * 0.8);
-   g.size.h = fmin(ch, u->size.h * 0.8);
-   g.origin.x = p->size.w * 0.5 - g.size.w * 0.5;
-   g.origin.y = p->size.h * 0.5 - g.size.h * 0.5;
-   wlc_view_set_geometry(view, &g);
+   layout_dialog(&g, size, parent, root);
+   commit_geometry(c->view, &g);
+
+   c->dialog.parent = parent->size;
+   c->dialog.root = root->size;
+   c->dialog.valid = true;
+}
+
+static void
+set_state(struct wlc_view *view, uint32_t state, bool toggle)
+{
+   wlc_view_set_state(view, state, toggle);
+
+   struct client *c;
+   if ((c = client_for_view(view)))
+      client_set_state(c, state, toggle);
 }
 
 static bool
-should_focus_on_create(struct wlc_view *view)
+should_focus_on_create(struct client *c)
 {
    // Do not allow unmanaged views to steal focus (tooltips, dnds, etc..)
    // Do not allow parented windows to steal focus, if current window wasn't parent.
-   uint32_t type = wlc_view_get_type(view);
-   struct wlc_view *parent = wlc_view_get_parent(view);
-   return (!(type & WLC_BIT_UNMANAGED) && (!loliwm.active || !parent || parent == loliwm.active));
+   return (!(c->type & WLC_BIT_UNMANAGED) && (!loliwm.active || !c->parent || c->parent->view == loliwm.active));
 }
 
 static bool
-is_or(struct wlc_view *view)
+is_or(struct client *c)
 {
-   return (wlc_view_get_type(view) & WLC_BIT_OVERRIDE_REDIRECT) || (wlc_view_get_state(view) & BIT_BEMENU);
+   return (c && (c->flags & CLIENT_OR));
 }
 
 static bool
-is_managed(struct wlc_view *view)
+is_managed(struct client *c)
 {
-   uint32_t type = wlc_view_get_type(view);
-   return !(type & WLC_BIT_UNMANAGED) && !(type & WLC_BIT_POPUP) && !(type & WLC_BIT_SPLASH);
+   return (c && (c->flags & CLIENT_MANAGED));
 }
 
 static bool
-is_modal(struct wlc_view *view)
+is_tiled(struct client *c)
 {
-   uint32_t type = wlc_view_get_type(view);
-   return (type & WLC_BIT_MODAL);
+   return (c && (c->flags & CLIENT_TILEABLE));
+}
+
+static enum layout_kind
+layout_kind_for_client(struct client *c)
+{
+   if (!c)
+      return LAYOUT_FLOATING;
+
+   if (is_managed(c) && !is_or(c) && c->parent)
+      return LAYOUT_DIALOG;
+
+   if (c->type & WLC_BIT_SPLASH)
+      return LAYOUT_SPLASH;
+
+   if (c->state & WLC_BIT_FULLSCREEN)
+      return LAYOUT_FULLSCREEN;
+
+   // Tiled views are taken from space.tiled
+   return LAYOUT_FLOATING;
 }
 
 static bool
-is_tiled(struct wlc_view *view)
+reserve_layout(uint32_t memb)
+{
+   if (memb <= loliwm.layout.capacity)
+      return true;
+
+   uint32_t capacity = (loliwm.layout.capacity ? loliwm.layout.capacity : 32);
+   while (capacity < memb)
+      capacity *= 2;
+
+   void *items, *views;
+   if (!(items = realloc(loliwm.layout.items, capacity * sizeof(struct layout_item))))
+      return false;
+
+   loliwm.layout.items = items;
+
+   if (!(views = realloc(loliwm.layout.views, capacity * sizeof(struct wlc_view*))))
+      return false;
+
+   loliwm.layout.views = views;
+   loliwm.layout.capacity = capacity;
+   return true;
+}
+
+static const struct wlc_geometry*
+laid_out_geometry(struct client *c, uint32_t memb)
+{
+   // Prefer geometry from this layout pass, the view might not have been pushed to wlc yet.
+   // Items below memb were all described in this pass, so the index can not be stale if the view matches.
+   if (c->layout_index < memb && loliwm.layout.views[c->layout_index] == c->view)
+      return &loliwm.layout.items[c->layout_index].geometry;
+
+   return wlc_view_get_geometry(c->view);
+}
+
+static void
+describe_view(struct wlc_view *view, struct client *c, enum layout_kind kind, uint32_t index)
+{
+   struct layout_item *it = &loliwm.layout.items[index];
+   it->kind = kind;
+   it->geometry = *wlc_view_get_geometry(view);
+
+   if (it->kind == LAYOUT_DIALOG) {
+      it->parent = laid_out_geometry(c->parent, index);
+      it->root = laid_out_geometry(c->root, index);
+      it->last.parent = c->dialog.parent;
+      it->last.root = c->dialog.root;
+      it->last.valid = (c->dialog.valid && c->commit.valid);
+   }
+
+   if (c)
+      c->layout_index = index;
+
+   loliwm.layout.views[index] = view;
+}
+
+static void
+apply_layout(struct space *s)
+{
+   assert(s);
+
+   uint32_t memb = wl_list_length(&s->views);
+   if (!reserve_layout(memb))
+      return;
+
+   // Tiled views first in layout order, rest in user order.
+   // Parents are always laid out before their dialogs this way.
+   uint32_t i = 0;
+   struct client *c;
+   wl_list_for_each(c, &s->tiled, tiled_link)
+      describe_view(c->view, c, LAYOUT_TILED, i++);
+
+   struct wlc_view *v;
+   wlc_view_for_each_user(v, &s->views) {
+      if ((c = client_for_view(v)) && c->tiled)
+         continue;
+
+      describe_view(v, c, layout_kind_for_client(c), i++);
+   }
+
+   struct wlc_output *output = wlc_space_get_output(s->space);
+   s->laid_out = *wlc_output_get_resolution(output);
+   layout_space(loliwm.layout.items, memb, &s->laid_out, loliwm.cut);
+
+   for (i = 0; i < memb; ++i) {
+      const struct layout_item *it = &loliwm.layout.items[i];
+      if (it->kind == LAYOUT_FLOATING)
+         continue;
+
+      if (it->kind == LAYOUT_DIALOG) {
+         if (it->last.kept) {
+            loliwm.stats.dialogs_kept++;
+            continue;
+         }
+
+         struct client *d = client_for_view(loliwm.layout.views[i]);
+         d->dialog.parent = it->last.parent;
+         d->dialog.root = it->last.root;
+         d->dialog.valid = true;
+      }
+
+      if (it->kind == LAYOUT_TILED)
+         commit_maximized(loliwm.layout.views[i], true);
+
+      commit_geometry(loliwm.layout.views[i], &it->geometry);
+   }
+}
+
+static void
+relayout_now(struct space *s)
+{
+   const uint64_t start = probe_begin();
+   apply_layout(s);
+   probe_end(PROBE_RELAYOUT, start);
+}
+
+static void
+flush_relayouts(void *data)
 {
-   uint32_t state = wlc_view_get_state(view);
-   return !(state & WLC_BIT_FULLSCREEN) && !wlc_view_get_parent(view) && is_managed(view) && !is_or(view) && !is_modal(view);
+   (void)data;
+   loliwm.flush = NULL;
+
+   struct space *s, *sn;
+   wl_list_for_each_safe(s, sn, &loliwm.dirty, dirty_link) {
+      wl_list_remove(&s->dirty_link);
+      wl_list_init(&s->dirty_link);
+      s->dirty = false;
+      relayout_now(s);
+   }
 }
 
 static void
@@ -94,349 +410,866 @@ relayout(struct wlc_space *space)
    if (!space)
       return;
 
-   struct wl_list *views;
-   if (!(views = wlc_space_get_userdata(space)))
+   struct space *s;
+   if (!(s = wlc_space_get_userdata(space)))
       return;
 
-   struct wlc_output *output = wlc_space_get_output(space);
-   const struct wlc_size *resolution = wlc_output_get_resolution(output);
+   loliwm.stats.relayouts++;
 
-   struct wlc_view *v;
-   uint32_t count = 0;
-   wlc_view_for_each_user(v, views)
-      if (is_tiled(v)) ++count;
-
-   bool toggle = false;
-   uint32_t y = 0, height = resolution->h / (count > 1 ? count - 1 : 1);
-   uint32_t fheight = (resolution->h > height * (count - 1) ? height + (resolution->h - height * (count - 1)) : height);
-   wlc_view_for_each_user(v, views) {
-      if (wlc_view_get_state(v) & WLC_BIT_FULLSCREEN)
-         wlc_view_set_geometry(v, &(struct wlc_geometry){ { 0, 0 }, *resolution });
-
-      if (wlc_view_get_type(v) & WLC_BIT_SPLASH) {
-         struct wlc_geometry g = *wlc_view_get_geometry(v);
-         g.origin = (struct wlc_origin){ resolution->w * 0.5 - g.size.w * 0.5, resolution->h * 0.5 - g.size.h * 0.5 };
-         wlc_view_set_geometry(v, &g);
+   // Many events can hit the same space within one dispatch, lay it out once when the loop goes idle.
+   if (s->dirty) {
+      loliwm.stats.relayouts_coalesced++;
+      return;
+   }
+
+   if (!loliwm.flush) {
+      struct wl_event_loop *loop;
+      if (!(loop = event_loop()) || !(loliwm.flush = wl_event_loop_add_idle(loop, flush_relayouts, NULL))) {
+         relayout_now(s);
+         return;
       }
+   }
 
-      struct wlc_view *parent;
-      if (is_managed(v) && !is_or(v) && (parent = wlc_view_get_parent(v)))
-         layout_parent(v, parent, &wlc_view_get_geometry(v)->size);
+   s->dirty = true;
+   wl_list_insert(loliwm.dirty.prev, &s->dirty_link);
+}
 
-      if (!is_tiled(v))
-         continue;
+// Every space loliwm frees goes through here, so no deferred relayout is left pointing at it.
+static void
+space_forget(struct wlc_space *space)
+{
+   struct space *s;
+   if (!space || !(s = wlc_space_get_userdata(space)))
+      return;
+
+   if (s->dirty) {
+      wl_list_remove(&s->dirty_link);
+      wl_list_init(&s->dirty_link);
+      s->dirty = false;
+   }
+
+   space_free(s);
+   wlc_space_set_userdata(space, NULL);
+}
+
+static void
+relayout_if_stale(struct wlc_space *space)
+{
+   // Resolution changes only lay out the active space, the rest wait until they are shown.
+   struct space *s;
+   if (!space || !(s = wlc_space_get_userdata(space)))
+      return;
+
+   const struct wlc_size *r = wlc_output_get_resolution(wlc_space_get_output(space));
+   if (s->laid_out.w == r->w && s->laid_out.h == r->h)
+      return;
 
-      uint32_t slave = resolution->w * loliwm.cut;
-      wlc_view_set_state(v, WLC_BIT_MAXIMIZED, true);
+   loliwm.stats.relayouts_stale++;
+   relayout(space);
+}
 
-      struct wlc_geometry g = {
-         .origin = { (toggle ? resolution->w - slave : 0), y },
-         .size = { (count > 1 ? (toggle ? slave : resolution->w - slave) : resolution->w), (toggle ? (y == 0 ? fheight : height) : resolution->h) },
-      };
+static void
+update_tiled(struct wlc_view *view)
+{
+   struct client *c;
+   if (!(c = client_for_view(view)) || !c->space)
+      return;
 
-      wlc_view_set_geometry(v, &g);
+   bool tiled = is_tiled(c);
+   if (tiled == c->tiled)
+      return;
 
-      if (toggle)
-         y += (y == 0 ? fheight : height);
+   if (!tiled) {
+      space_untile(c->space, c);
+      return;
+   }
 
-      toggle = true;
+   // Put it back after the closest tiled view before it in the views list.
+   struct client *after = NULL;
+   for (struct wl_list *l = wlc_view_get_user_link(view)->prev; l != &c->space->views; l = l->prev) {
+      struct client *p;
+      if ((p = client_for_view(wlc_view_from_user_link(l))) && p->tiled) {
+         after = p;
+         break;
+      }
    }
+
+   space_tile(c->space, c, after);
+}
+
+static void
+update_indexes(struct wlc_view *view)
+{
+   struct client *c;
+   if (!(c = client_for_view(view)) || !c->space)
+      return;
+
+   space_set_fullscreen(c->space, c, (c->state & WLC_BIT_FULLSCREEN));
+   update_tiled(view);
 }
 
 static void
 cycle(struct wlc_compositor *compositor)
 {
-   struct wl_list *l = wlc_space_get_userdata(wlc_compositor_get_focused_space(compositor));
+   struct wlc_space *space = wlc_compositor_get_focused_space(compositor);
+   struct space *s = wlc_space_get_userdata(space);
+   if (!s || s->tiled_count <= 1)
+      return;
 
-   if (!l)
+   struct client *first = wl_container_of(s->tiled.next, first, tiled_link);
+   if (!space_cycle(s))
       return;
 
-   struct wlc_view *v;
-   uint32_t count = 0;
-   wlc_view_for_each_user(v, l)
-      if (is_tiled(v)) ++count;
+   // Last tile comes first, in the views list too so focus next and previous walk tiles in
+   // on-screen order. Other views keep their place.
+   struct client *moved = wl_container_of(s->tiled.next, moved, tiled_link);
+   struct wl_list *link = wlc_view_get_user_link(moved->view);
+   wl_list_remove(link);
+   wl_list_insert(wlc_view_get_user_link(first->view)->prev, link);
+
+   relayout(space);
+}
+
+static void
+raise_view(struct wlc_view *view)
+{
+   wlc_view_bring_to_front(view);
 
-   // Check that we have at least two tiled views
-   // so we don't get in infinite loop.
-   if (count <= 1)
+   struct client *c;
+   if (!(c = client_for_view(view)))
       return;
 
-   // Cycle until we hit next tiled view.
-   struct wl_list *p;
-   do {
-      p = l->prev;
-      wl_list_remove(l->prev);
-      wl_list_insert(l, p);
-   } while (!is_tiled(wlc_view_from_user_link(p)));
+   if (c->space) {
+      space_raise(c->space, c);
+   } else {
+      client_raise(c);
+   }
+}
 
-   relayout(wlc_compositor_get_focused_space(compositor));
+static struct client*
+topmost_child(struct client *c, struct wlc_space *space)
+{
+   struct client *child;
+   wl_list_for_each_reverse(child, &c->children, child_link) {
+      if (child->space && child->space->space == space)
+         return child;
+   }
+   return NULL;
+}
+
+static bool
+restack_push(struct wlc_view *view)
+{
+   if (loliwm.restack.memb >= loliwm.restack.capacity) {
+      uint32_t capacity = (loliwm.restack.capacity ? loliwm.restack.capacity * 2 : 16);
+
+      void *views;
+      if (!(views = realloc(loliwm.restack.views, capacity * sizeof(struct wlc_view*))))
+         return false;
+
+      loliwm.restack.views = views;
+      loliwm.restack.capacity = capacity;
+   }
+
+   loliwm.restack.views[loliwm.restack.memb++] = view;
+   return true;
+}
+
+static bool
+restack_contains(struct wlc_view *view, uint32_t from)
+{
+   for (uint32_t i = from; i < loliwm.restack.memb; ++i) {
+      if (loliwm.restack.views[i] == view)
+         return true;
+   }
+   return false;
 }
 
 static void
-raise_all(struct wlc_view *view)
+restack_family(struct client *c)
 {
-   assert(view);
+   assert(c);
 
    // Raise view and all related views to top honoring the stacking order.
-   struct wlc_view *parent;
-   if ((parent = wlc_view_get_parent(view))) {
-      raise_all(parent);
-
-      struct wlc_view *v, *vn;
-      struct wl_list *views = wlc_space_get_views(wlc_view_get_space(view));
-      wlc_view_for_each_safe(v, vn, views) {
-         if (v == view || wlc_view_get_parent(v) != parent)
-            continue;
+   if (c->parent) {
+      restack_family(c->parent);
 
-         wlc_view_bring_to_front(v);
+      struct client *s;
+      wl_list_for_each(s, &c->parent->children, child_link) {
+         if (s != c && s->space == c->space)
+            restack_push(s->view);
       }
    }
 
-   wlc_view_bring_to_front(view);
+   restack_push(c->view);
 }
 
 static void
-set_active(struct wlc_compositor *compositor, struct wlc_view *view)
+restack_commit(struct wlc_space *space)
+{
+   // Nothing to do if the top of the stack is already in this order.
+   // This is the usual case when focus moves back and forth inside a dialog tree.
+   struct wl_list *views = wlc_space_get_views(space), *l = (views ? views->prev : NULL);
+   uint32_t i;
+   for (i = loliwm.restack.memb; l && i > 0 && l != views; --i, l = l->prev) {
+      if (wlc_view_from_link(l) != loliwm.restack.views[i - 1])
+         break;
+   }
+
+   if (l && i == 0) {
+      loliwm.stats.restacks_skipped++;
+      return;
+   }
+
+   for (i = 0; i < loliwm.restack.memb; ++i)
+      raise_view(loliwm.restack.views[i]);
+
+   loliwm.stats.restacks++;
+}
+
+static void
+activate(struct wlc_compositor *compositor, struct wlc_view *view)
 {
    if (loliwm.active == view)
       return;
 
    // Bemenu should always have focus when open.
-   if (loliwm.active && (wlc_view_get_state(loliwm.active) & BIT_BEMENU)) {
-      wlc_view_bring_to_front(loliwm.active);
+   struct client *a = client_for_view(loliwm.active);
+   if (a && (a->state & BIT_BEMENU)) {
+      raise_view(loliwm.active);
       return;
    }
 
    if (view) {
-      struct wlc_view *v;
-      struct wl_list *views = wlc_space_get_views(wlc_view_get_space(view));
-      wlc_view_for_each_reverse(v, views) {
-         if (wlc_view_get_parent(v) == view) {
-            // If window has parent, focus it instead of this.
-            // By reverse searching views list, we get the topmost parent.
-            set_active(compositor, v);
-            return;
-         }
+      struct client *c = client_for_view(view), *child;
+      if (c && (child = topmost_child(c, wlc_view_get_space(view)))) {
+         // If window has parent, focus it instead of this.
+         // Children are kept in stacking order, so we get the topmost parent.
+         activate(compositor, child->view);
+         return;
+      }
+
+      // Only set active for current view to false, if new view is on same output and the new view is managed.
+      if (a && is_managed(c) && wlc_space_get_output(wlc_view_get_space(loliwm.active)) == wlc_space_get_output(wlc_view_get_space(view))) {
+         wlc_view_set_state(loliwm.active, WLC_BIT_ACTIVATED, false);
+         client_set_state(a, WLC_BIT_ACTIVATED, false);
       }
 
-      // Only raise fullscreen views when focused view is managed
-      if (is_managed(view) && !is_or(view)) {
-         wlc_view_for_each_reverse(v, views) {
-            if (wlc_view_get_state(v) & WLC_BIT_FULLSCREEN) {
-               // Bring the first topmost found fullscreen wlc_view to front.
-               // This way we get a "peek" effect when we cycle other views.
-               // Meaning the active view is always over fullscreen view,
-               // but fullscreen view is on top of the other views.
-               wlc_view_bring_to_front(v);
-               break;
-            }
-         }
-      }
+      set_state(view, WLC_BIT_ACTIVATED, true);
+
+      // Work out the final z-order first, then restack in one go.
+      loliwm.restack.memb = 0;
+
+      // Only raise fullscreen views when focused view is managed
+      struct space *s = wlc_space_get_userdata(wlc_view_get_space(view));
+      struct client *f = NULL;
+      if (s && !wl_list_empty(&s->fullscreen) && is_managed(c) && !is_or(c)) {
+         // Bring the topmost fullscreen wlc_view to front.
+         // This way we get a "peek" effect when we cycle other views.
+         // Meaning the active view is always over fullscreen view,
+         // but fullscreen view is on top of the other views.
+         f = wl_container_of(s->fullscreen.prev, f, fullscreen_link);
+         restack_push(f->view);
+      }
+
+      if (c) {
+         restack_family(c);
+      } else {
+         restack_push(view);
+      }
+
+      // Fullscreen view that is part of the family keeps its place in it.
+      if (f && restack_contains(f->view, 1))
+         memmove(loliwm.restack.views, loliwm.restack.views + 1, --loliwm.restack.memb * sizeof(struct wlc_view*));
+
+      // Always bring bemenu to front when exists.
+      if (s && s->bemenu && !restack_contains(s->bemenu->view, 0))
+         restack_push(s->bemenu->view);
+
+      restack_commit(wlc_view_get_space(view));
+   }
+
+   // Remember focus for when this view goes away, only views that are fine to give focus back to.
+   struct client *c;
+   if ((c = client_for_view(view)) && c->space && is_managed(c) && !is_or(c))
+      space_note_focus(c->space, c, true);
+
+   wlc_compositor_focus_view(compositor, view);
+   loliwm.active = view;
+}
+
+static void
+set_active(struct wlc_compositor *compositor, struct wlc_view *view)
+{
+   const uint64_t start = probe_begin();
+   activate(compositor, view);
+   probe_end(PROBE_SET_ACTIVE, start);
+}
+
+static struct client*
+last_focused(struct wlc_space *space)
+{
+   struct space *s;
+   if (loliwm.fallback != FOCUS_FALLBACK_MRU || !space || !(s = wlc_space_get_userdata(space)))
+      return NULL;
+
+   return space_last_focused(s);
+}
+
+static void
+active_space(struct wlc_compositor *compositor, struct wlc_space *space)
+{
+   struct wl_list *views = wlc_space_get_views(space);
+
+   struct client *c;
+   if ((c = last_focused(space))) {
+      set_active(compositor, c->view);
+   } else if (views && !wl_list_empty(views)) {
+      set_active(compositor, wlc_view_from_link(views->prev));
+   } else {
+      set_active(compositor, NULL);
+   }
+}
+
+static void
+focus_next_or_previous_view(struct wlc_compositor *compositor, struct wlc_view *view, bool direction)
+{
+
+   struct wl_list *l = (direction ? wlc_view_get_user_link(view)->next : wlc_view_get_user_link(view)->prev);
+   struct space *s = wlc_space_get_userdata(wlc_view_get_space(view));
+   if (!l || !s || wl_list_empty(&s->views))
+      return;
+
+   if (l == &s->views && (direction ? !(l = l->next) : !(l = l->prev)))
+      return;
+
+   struct wlc_view *v;
+   if (!(v = wlc_view_from_user_link(l)))
+      return;
+
+   set_active(compositor, v);
+}
+
+static void
+release_heads(void)
+{
+   for (uint32_t i = 0; i < loliwm.heads.memb; ++i)
+      free(loliwm.heads.items[i].spaces);
+
+   free(loliwm.heads.items);
+   memset(&loliwm.heads, 0, sizeof(loliwm.heads));
+}
+
+static bool
+index_heads(struct wlc_compositor *compositor, struct wlc_output *gone)
+{
+   // Outputs only come and go on hotplug, rebuilding everything then keeps lookups plain array reads.
+   release_heads();
+
+   struct wlc_output *o;
+   struct wl_list *outputs = wlc_compositor_get_outputs(compositor);
+   uint32_t memb = 0;
+   wlc_output_for_each(o, outputs) {
+      if (o != gone)
+         ++memb;
+   }
+
+   if (!memb)
+      return true;
+
+   if (!(loliwm.heads.items = calloc(memb, sizeof(struct head))))
+      return false;
+
+   struct wlc_output *focused = wlc_compositor_get_focused_output(compositor);
+   wlc_output_for_each(o, outputs) {
+      if (o == gone)
+         continue;
+
+      struct head *h = &loliwm.heads.items[loliwm.heads.memb++];
+      h->output = o;
+
+      if (o == focused)
+         loliwm.heads.focused = loliwm.heads.memb - 1;
+
+      struct wlc_space *s;
+      wlc_space_for_each(s, wlc_output_get_spaces(o))
+         ++h->memb;
+
+      if (!(h->spaces = calloc(h->memb, sizeof(struct wlc_space*)))) {
+         release_heads();
+         return false;
+      }
+
+      uint32_t i = 0;
+      wlc_space_for_each(s, wlc_output_get_spaces(o))
+         h->spaces[i++] = s;
+   }
+
+   return true;
+}
+
+static struct head*
+head_for_output(struct wlc_output *output)
+{
+   if (!output)
+      return NULL;
+
+   if (loliwm.heads.focused < loliwm.heads.memb && loliwm.heads.items[loliwm.heads.focused].output == output)
+      return &loliwm.heads.items[loliwm.heads.focused];
+
+   for (uint32_t i = 0; i < loliwm.heads.memb; ++i) {
+      if (loliwm.heads.items[i].output == output)
+         return &loliwm.heads.items[i];
+   }
+
+   return NULL;
+}
+
+static struct wlc_space*
+space_for_index(struct wlc_output *output, int index)
+{
+   struct head *h;
+   if (index < 0 || !(h = head_for_output(output)) || (uint32_t)index >= h->memb)
+      return NULL;
+
+   return h->spaces[index];
+}
+
+static void
+focus_space(struct wlc_compositor *compositor, int index)
+{
+   struct wlc_space *s;
+   if ((s = space_for_index(wlc_compositor_get_focused_output(compositor), index)) && s != loliwm.terminal.hidden)
+      wlc_output_focus_space(wlc_space_get_output(s), s);
+}
+
+static struct wlc_output*
+output_for_index(int index)
+{
+   return (index >= 0 && (uint32_t)index < loliwm.heads.memb ? loliwm.heads.items[index].output : NULL);
+}
+
+static void
+move_to_output(struct wlc_compositor *compositor, struct wlc_view *view, int index)
+{
+   struct wlc_output *o = output_for_index(index);
+
+   if (o) {
+      wlc_view_set_space(view, wlc_output_get_active_space(o));
+      wlc_compositor_focus_output(compositor, o);
+   }
+}
+
+static void
+move_to_space(struct wlc_compositor *compositor, struct wlc_view *view, int index)
+{
+   struct wlc_space *s = space_for_index(wlc_compositor_get_focused_output(compositor), index);
+
+   if (s && s != loliwm.terminal.hidden)
+      wlc_view_set_space(view, s);
+}
+
+static void
+focus_next_or_previous_output(struct wlc_compositor *compositor, bool direction)
+{
+   struct wlc_output *active;
+   if (!(active = wlc_compositor_get_focused_output(compositor)))
+      return;
+
+   struct wl_list *l = (direction ? wlc_output_get_link(active)->next : wlc_output_get_link(active)->prev);
+   struct wl_list *outputs = wlc_compositor_get_outputs(compositor);
+   if (!l || wl_list_empty(outputs))
+      return;
+
+   if (l == outputs && (direction ? !(l = l->next) : !(l = l->prev)))
+      return;
+
+   struct wlc_output *o;
+   if (!(o = wlc_output_from_link(l)))
+      return;
+
+   wlc_compositor_focus_output(compositor, o);
+}
+
+static const char*
+terminal_command(void)
+{
+   const char *terminal = getenv("TERMINAL");
+   return (terminal ? terminal : DEFAULT_TERM);
+}
+
+#if LOLIWM_VIEW_PID
+static pid_t
+parent_pid(pid_t pid)
+{
+   char path[32], buf[256];
+   snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+
+   FILE *f;
+   if (!(f = fopen(path, "r")))
+      return -1;
+
+   const size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+   fclose(f);
+   buf[len] = 0;
+
+   // Parent follows the state, after the command name which may contain anything.
+   const char *cmd;
+   int ppid;
+   if (!(cmd = strrchr(buf, ')')) || sscanf(cmd + 1, " %*c %d", &ppid) != 1)
+      return -1;
+
+   return ppid;
+}
+
+static int32_t
+terminal_launch_for_view(struct wlc_view *view)
+{
+   if (wlc_view_get_parent(view))
+      return -1;
+
+   // $TERMINAL may be a script that starts the terminal as its child, look a few parents up.
+   pid_t pid = wlc_view_get_pid(view);
+   for (uint32_t depth = 0; depth < 4 && pid > 1 && pid != getpid(); ++depth, pid = parent_pid(pid)) {
+      for (uint32_t i = 0; i < loliwm.terminal.starting; ++i) {
+         if (loliwm.terminal.launches[i].pid == pid)
+            return i;
+      }
+   }
+
+   return -1;
+}
+#else
+static int32_t
+terminal_launch_for_view(struct wlc_view *view)
+{
+   if (wlc_view_get_parent(view))
+      return -1;
+
+   // Without the pid of the view, class has to match the file name of the terminal.
+   // It is taken for the launch waited on longest, which is the next to expire anyway.
+   const char *class, *command = terminal_command(), *base = strrchr(command, '/');
+   base = (base ? base + 1 : command);
+   if (!(class = wlc_view_get_class(view)) || strcmp(class, base))
+      return -1;
+
+   int32_t oldest = -1;
+   for (uint32_t i = 0; i < loliwm.terminal.starting; ++i) {
+      if (oldest < 0 || loliwm.terminal.launches[i].since < loliwm.terminal.launches[oldest].since)
+         oldest = i;
+   }
+
+   return oldest;
+}
+#endif
+
+static void
+forget_launch(uint32_t index)
+{
+   assert(index < loliwm.terminal.starting);
+   loliwm.terminal.launches[index] = loliwm.terminal.launches[--loliwm.terminal.starting];
+}
+
+static void
+expire_launches(void)
+{
+   const uint64_t now = now_us();
+   for (uint32_t i = 0; i < loliwm.terminal.starting;) {
+      if (now - loliwm.terminal.launches[i].since < TERMINAL_START_TIMEOUT_MS * 1000ull) {
+         ++i;
+         continue;
+      }
+
+      // Died, or maps its windows from some other process.
+      trace(TRACE_WARN, "terminal %d did not map in %u ms, giving up on it", (int)loliwm.terminal.launches[i].pid, TERMINAL_START_TIMEOUT_MS);
+      forget_launch(i);
+   }
+
+   // Presses that were waiting for them are given up too.
+   if (loliwm.terminal.wanted > loliwm.terminal.starting)
+      loliwm.terminal.wanted = loliwm.terminal.starting;
+}
+
+static bool
+launch_terminal(void)
+{
+   if (loliwm.terminal.starting >= TERMINAL_STARTING_MAX) {
+      trace(TRACE_WARN, "%u terminals still starting, not launching another", loliwm.terminal.starting);
+      return false;
+   }
+
+   pid_t pid;
+   if ((pid = launch(terminal_command())) < 0)
+      return false;
+
+   loliwm.terminal.launches[loliwm.terminal.starting].pid = pid;
+   loliwm.terminal.launches[loliwm.terminal.starting].since = now_us();
+   loliwm.terminal.starting++;
+   return true;
+}
+
+static bool
+terminal_mapped(struct wlc_view *view, uint32_t launch)
+{
+   forget_launch(launch);
+
+   if (loliwm.terminal.wanted) {
+      // Presses after the first one are timed from the first, good enough for mashing the key.
+      const uint64_t us = now_us() - loliwm.terminal.pressed;
+      loliwm.terminal.wanted--;
+      loliwm.stats.terminals_launched++;
+      loliwm.stats.launched_us += us;
+      trace(TRACE_INFO, "terminal %p mapped %" PRIu64 " us after key press", (void*)view, us);
+
+      if (loliwm.terminal.prewarm && !loliwm.terminal.ready && loliwm.terminal.starting == loliwm.terminal.wanted)
+         launch_terminal();
+
+      return false;
+   }
+
+   // Nobody asked for this one, keep it for the next key press.
+   return (loliwm.terminal.prewarm && loliwm.terminal.hidden && !loliwm.terminal.ready);
+}
+
+static bool
+view_created(struct wlc_compositor *compositor, struct wlc_view *view, struct wlc_space *space)
+{
+   (void)compositor;
+
+   struct space *s;
+   if (!(s = wlc_space_get_userdata(space))) {
+      if (!(s = space_new(space)))
+         return false;
 
-      // Only set active for current view to false, if new view is on same output and the new view is managed.
-      if (loliwm.active && is_managed(view) && wlc_space_get_output(wlc_view_get_space(loliwm.active)) == wlc_space_get_output(wlc_view_get_space(view)))
-         wlc_view_set_state(loliwm.active, WLC_BIT_ACTIVATED, false);
+      wlc_space_set_userdata(space, s);
+   }
 
-      wlc_view_set_state(view, WLC_BIT_ACTIVATED, true);
-      raise_all(view);
+   if (wlc_view_get_class(view) && !strcmp(wlc_view_get_class(view), "bemenu")) {
+      // Do not allow more than one bemenu instance
+      struct client *a = client_for_view(loliwm.active);
+      if (a && (a->state & BIT_BEMENU))
+         return false;
 
-      wlc_view_for_each_reverse(v, views) {
-         if ((wlc_view_get_state(v) & BIT_BEMENU)) {
-            // Always bring bemenu to front when exists.
-            wlc_view_bring_to_front(v);
-            break;
-         }
-      }
+      set_state(view, BIT_BEMENU, true); // XXX: Hack
    }
 
-   wlc_compositor_focus_view(compositor, view);
-   loliwm.active = view;
-}
+   bool park = false;
+   struct client *c;
+   if (!(c = client_for_view(view))) {
+      int32_t launch;
+      if (loliwm.terminal.starting && (launch = terminal_launch_for_view(view)) >= 0)
+         park = terminal_mapped(view, launch);
 
-static void
-active_space(struct wlc_compositor *compositor, struct wlc_space *space)
-{
-   struct wl_list *views = wlc_space_get_views(space);
+      if (!(c = client_add(view)))
+         return false;
 
-   if (views && !wl_list_empty(views)) {
-      set_active(compositor, wlc_view_from_link(views->prev));
-   } else {
-      set_active(compositor, NULL);
+      // Only read back from wlc here, loliwm keeps the copies in sync after this.
+      c->type = wlc_view_get_type(view);
+      c->state = wlc_view_get_state(view);
+      c->commit.maximized = (c->state & WLC_BIT_MAXIMIZED);
+      client_set_parent(c, client_for_view(wlc_view_get_parent(view)));
    }
-}
 
-static void
-focus_next_or_previous_view(struct wlc_compositor *compositor, struct wlc_view *view, bool direction)
-{
+   wl_list_insert(s->views.prev, wlc_view_get_user_link(view));
+   c->space = s;
 
-   struct wl_list *l = (direction ? wlc_view_get_user_link(view)->next : wlc_view_get_user_link(view)->prev);
-   struct wl_list *views = wlc_space_get_userdata(wlc_view_get_space(view));
-   if (!l || !views || wl_list_empty(views))
-      return;
+   // Views that never had focus here come back last, focusing moves them up.
+   if (is_managed(c) && !is_or(c))
+      space_note_focus(s, c, false);
 
-   if (l == views && (direction ? !(l = l->next) : !(l = l->prev)))
-      return;
+   if (c->state & BIT_BEMENU)
+      s->bemenu = c;
+   update_indexes(view);
 
-   struct wlc_view *v;
-   if (!(v = wlc_view_from_user_link(l)))
-      return;
+   if (!park && space != loliwm.terminal.hidden && should_focus_on_create(c))
+      set_active(compositor, view);
 
-   set_active(compositor, v);
-}
+   relayout(space);
+   trace(TRACE_INFO, "new view: %p (%p, depth %u)", (void*)view, (void*)(c->parent ? c->parent->view : NULL), c->depth);
 
-static struct wlc_space*
-space_for_index(struct wl_list *spaces, int index)
-{
-   int i = 0;
-   struct wlc_space *s;
-   wlc_space_for_each(s, spaces) {
-      if (index == i)
-         return s;
-      ++i;
+   if (park) {
+      loliwm.terminal.ready = view;
+      wlc_view_set_space(view, loliwm.terminal.hidden);
    }
-   return NULL;
+   return true;
 }
 
 static void
-focus_space(struct wlc_compositor *compositor, int index)
+hover_cancel(void)
 {
-   struct wlc_output *output;
-   if (!(output = wlc_compositor_get_focused_output(compositor)))
-      return;
+   if (loliwm.hover.pending && loliwm.hover.timer)
+      wl_event_source_timer_update(loliwm.hover.timer, 0);
 
-   struct wlc_space *s;
-   if ((s = space_for_index(wlc_output_get_spaces(output), index)))
-      wlc_output_focus_space(wlc_space_get_output(s), s);
+   loliwm.hover.pending = false;
+   loliwm.hover.view = NULL;
 }
 
-static struct wlc_output*
-output_for_index(struct wl_list *outputs, int index)
+static void
+apply_geometry_request(struct client *c, const struct wlc_geometry *geometry)
 {
-   int i = 0;
-   struct wlc_output *o;
-   wlc_output_for_each(o, outputs) {
-      if (index == i)
-         return o;
-      ++i;
+   if (is_managed(c) && !is_or(c) && c->parent) {
+      layout_parent(c, &geometry->size);
+   } else {
+      commit_geometry(c->view, geometry);
    }
-   return NULL;
 }
 
 static void
-move_to_output(struct wlc_compositor *compositor, struct wlc_view *view, int index)
+drag_cancel(void)
 {
-   struct wl_list *outputs = wlc_compositor_get_outputs(compositor);
-   struct wlc_output *o = output_for_index(outputs, index);
+   if (loliwm.drag.armed && loliwm.drag.timer)
+      wl_event_source_timer_update(loliwm.drag.timer, 0);
 
-   if (o) {
-      wlc_view_set_space(view, wlc_output_get_active_space(o));
-      wlc_compositor_focus_output(compositor, o);
-   }
+   if (loliwm.drag.has_pending)
+      loliwm.stats.drag_dropped++;
+
+   loliwm.drag.view = NULL;
+   loliwm.drag.armed = loliwm.drag.has_pending = false;
 }
 
 static void
-move_to_space(struct wlc_compositor *compositor, struct wlc_view *view, int index)
+drag_flush(void)
 {
-   struct wlc_space *active = wlc_compositor_get_focused_space(compositor);
-   struct wl_list *spaces = wlc_output_get_spaces(wlc_space_get_output(active));
-   struct wlc_space *s = space_for_index(spaces, index);
+   struct client *c;
+   if (loliwm.drag.has_pending && (c = client_for_view(loliwm.drag.view))) {
+      loliwm.drag.has_pending = false;
+      apply_geometry_request(c, &loliwm.drag.pending);
+      loliwm.stats.drag_applied++;
+   }
 
-   if (s)
-      wlc_view_set_space(view, s);
+   drag_cancel();
 }
 
-static void
-focus_next_or_previous_output(struct wlc_compositor *compositor, bool direction)
+static int
+drag_tick(void *data)
 {
-   struct wlc_output *active;
-   if (!(active = wlc_compositor_get_focused_output(compositor)))
-      return;
-
-   struct wl_list *l = (direction ? wlc_output_get_link(active)->next : wlc_output_get_link(active)->prev);
-   struct wl_list *outputs = wlc_compositor_get_outputs(compositor);
-   if (!l || wl_list_empty(outputs))
-      return;
-
-   if (l == outputs && (direction ? !(l = l->next) : !(l = l->prev)))
-      return;
+   (void)data;
 
-   struct wlc_output *o;
-   if (!(o = wlc_output_from_link(l)))
-      return;
+   // Nothing came in during the last frame, the next request is applied right away again.
+   struct client *c;
+   if (!loliwm.drag.has_pending || !(c = client_for_view(loliwm.drag.view))) {
+      drag_cancel();
+      return 0;
+   }
 
-   wlc_compositor_focus_output(compositor, o);
+   loliwm.drag.has_pending = false;
+   apply_geometry_request(c, &loliwm.drag.pending);
+   loliwm.stats.drag_applied++;
+   wl_event_source_timer_update(loliwm.drag.timer, (1000 + loliwm.drag.fps / 2) / loliwm.drag.fps);
+   return 0;
 }
 
 static bool
-view_created(struct wlc_compositor *compositor, struct wlc_view *view, struct wlc_space *space)
+drag_throttle(struct client *c, const struct wlc_geometry *geometry)
 {
-   (void)compositor;
+   if (!loliwm.drag.fps)
+      return false;
 
-   struct wl_list *views;
-   if (!(views = wlc_space_get_userdata(space))) {
-      if (!(views = calloc(1, sizeof(struct wl_list))))
+   if (!loliwm.drag.timer) {
+      struct wl_event_loop *loop;
+      if (!(loop = event_loop()) || !(loliwm.drag.timer = wl_event_loop_add_timer(loop, drag_tick, NULL)))
          return false;
-
-      wl_list_init(views);
-      wlc_space_set_userdata(space, views);
    }
 
-   if (wlc_view_get_class(view) && !strcmp(wlc_view_get_class(view), "bemenu")) {
-      // Do not allow more than one bemenu instance
-      if (loliwm.active && wlc_view_get_state(loliwm.active) & BIT_BEMENU)
-         return false;
+   // Only one view is dragged at a time, finish the previous one if it did not tell.
+   if (loliwm.drag.view && loliwm.drag.view != c->view)
+      drag_flush();
 
-      wlc_view_set_state(view, BIT_BEMENU, true); // XXX: Hack
+   // First request of a frame goes through, later ones replace each other until the timer fires.
+   if (!loliwm.drag.armed) {
+      loliwm.drag.view = c->view;
+      loliwm.drag.armed = true;
+      wl_event_source_timer_update(loliwm.drag.timer, (1000 + loliwm.drag.fps / 2) / loliwm.drag.fps);
+      return false;
    }
 
-   wl_list_insert(views->prev, wlc_view_get_user_link(view));
-
-   if (should_focus_on_create(view))
-      set_active(compositor, view);
+   if (loliwm.drag.has_pending)
+      loliwm.stats.drag_dropped++;
 
-   relayout(space);
-   wlc_log(WLC_LOG_INFO, "new view: %p (%p)", view, wlc_view_get_parent(view));
+   loliwm.drag.pending = *geometry;
+   loliwm.drag.has_pending = true;
    return true;
 }
 
 static void
-view_destroyed(struct wlc_compositor *compositor, struct wlc_view *view)
+unlist_view(struct wlc_view *view)
 {
+   struct client *c;
+   if ((c = client_for_view(view)) && c->space) {
+      space_untile(c->space, c);
+      space_set_fullscreen(c->space, c, false);
+      space_forget_focus(c->space, c);
+
+      if (c->space->bemenu == c)
+         c->space->bemenu = NULL;
+
+      c->space = NULL;
+   }
+
    wl_list_remove(wlc_view_get_user_link(view));
+}
 
+static void
+view_destroyed(struct wlc_compositor *compositor, struct wlc_view *view)
+{
+   unlist_view(view);
+
+   struct client *c = client_for_view(view), *child, *cn, *last;
    if (loliwm.active == view) {
       loliwm.active = NULL;
 
       struct wl_list *link = wlc_view_get_link(view);
-      struct wlc_view *v = wlc_view_get_parent(view);
+      struct wlc_view *v = (c && c->parent ? c->parent->view : NULL);
       if (v) {
          // Focus the parent view, if there was one
          // Set parent NULL before this to avoid focusing back to dying view
+         client_set_parent(c, NULL);
          wlc_view_set_parent(view, NULL);
          set_active(compositor, v);
+      } else if ((last = last_focused(wlc_view_get_space(view)))) {
+         // View is already unlisted, so this is the one focused before it.
+         set_active(compositor, last->view);
       } else if (link && link->prev != link->next) {
          // Otherwise focus previous one (stacking order).
          set_active(compositor, wlc_view_from_link(link->prev));
       }
    }
 
+   // Dialogs outlive their parent as normal views, wlc orphans them too.
+   if (c) {
+      wl_list_for_each_safe(child, cn, &c->children, child_link) {
+         client_set_parent(child, NULL);
+         wlc_view_set_parent(child->view, NULL);
+         update_indexes(child->view);
+         relayout(wlc_view_get_space(child->view));
+      }
+   }
+
    struct wlc_space *space = wlc_view_get_space(view);
    if (space) {
-      relayout(wlc_view_get_space(view));
-      struct wl_list *views = wlc_space_get_userdata(space);
-      if (views && wl_list_empty(views)) {
-         free(views);
-         wlc_space_set_userdata(wlc_view_get_space(view), NULL);
-      }
+      relayout(space);
+      struct space *s = wlc_space_get_userdata(space);
+      if (s && wl_list_empty(&s->views))
+         space_forget(space);
    }
 
-   wlc_log(WLC_LOG_INFO, "view destroyed: %p", view);
+   if (loliwm.hover.pending && loliwm.hover.view == view)
+      hover_cancel();
+
+   if (loliwm.drag.view == view)
+      drag_cancel();
+
+   if (loliwm.terminal.ready == view)
+      loliwm.terminal.ready = NULL;
+
+   client_remove(view);
+   trace(TRACE_INFO, "view destroyed: %p", (void*)view);
 }
 
 static void
 view_switch_space(struct wlc_compositor *compositor, struct wlc_view *view, struct wlc_space *from, struct wlc_space *to)
 {
-   wl_list_remove(wlc_view_get_user_link(view));
+   unlist_view(view);
    relayout(from);
    view_created(compositor, view, to);
 
@@ -445,7 +1278,7 @@ view_switch_space(struct wlc_compositor *compositor, struct wlc_view *view, stru
    } else {
       struct wlc_view *v;
       wlc_view_for_each_reverse(v, wlc_space_get_views(from)) {
-         wlc_view_set_state(v, WLC_BIT_ACTIVATED, true);
+         set_state(v, WLC_BIT_ACTIVATED, true);
          break;
       }
    }
@@ -456,7 +1289,7 @@ view_switch_space(struct wlc_compositor *compositor, struct wlc_view *view, stru
          if (v == loliwm.active)
             continue;
 
-         wlc_view_set_state(v, WLC_BIT_ACTIVATED, false);
+         set_state(v, WLC_BIT_ACTIVATED, false);
       }
    }
 }
@@ -466,35 +1299,52 @@ view_geometry_request(struct wlc_compositor *compositor, struct wlc_view *view,
 {
    (void)compositor;
 
-   uint32_t type = wlc_view_get_type(view);
-   uint32_t state = wlc_view_get_state(view);
-   bool tiled = is_tiled(view);
-   bool action = ((state & WLC_BIT_RESIZING) || (state & WLC_BIT_MOVING));
+   // Views loliwm refused are left alone.
+   struct client *c;
+   if (!(c = client_for_view(view))) {
+      commit_geometry(view, geometry);
+      return;
+   }
+
+   bool tiled = c->tiled;
+   bool action = ((c->state & WLC_BIT_RESIZING) || (c->state & WLC_BIT_MOVING));
 
    if (tiled && !action)
       return;
 
    if (tiled)
-      wlc_view_set_state(view, WLC_BIT_MAXIMIZED, false);
+      commit_maximized(view, false);
 
-   if ((state & WLC_BIT_FULLSCREEN) || (type & WLC_BIT_SPLASH))
+   if ((c->state & WLC_BIT_FULLSCREEN) || (c->type & WLC_BIT_SPLASH))
       return;
 
-   struct wlc_view *parent;
-   if (is_managed(view) && !is_or(view) && (parent = wlc_view_get_parent(view))) {
-      layout_parent(view, parent, &geometry->size);
-   } else {
-      wlc_view_set_geometry(view, geometry);
-   }
+   // Every configure makes the client redraw, pointer driven ones come faster than frames.
+   if (action && drag_throttle(c, geometry))
+      return;
+
+   if (action)
+      loliwm.stats.drag_applied++;
+
+   apply_geometry_request(c, geometry);
 }
 
 static void
 view_state_request(struct wlc_compositor *compositor, struct wlc_view *view, const enum wlc_view_state_bit state, const bool toggle)
 {
    (void)compositor;
-   wlc_view_set_state(view, state, toggle);
+   set_state(view, state, toggle);
+
+   // Drag ended, the last position it was given has to stick.
+   if ((state & (WLC_BIT_RESIZING | WLC_BIT_MOVING)) && !toggle && loliwm.drag.view == view)
+      drag_flush();
+
+   struct client *c;
+   if ((state & WLC_BIT_MAXIMIZED) && (c = client_for_view(view)))
+      c->commit.maximized = toggle;
+
+   update_indexes(view);
 
-   wlc_log(WLC_LOG_INFO, "STATE: %d (%d)", state, toggle);
+   trace(TRACE_DEBUG, "STATE: %d (%d)", state, toggle);
    switch (state) {
       case WLC_BIT_MAXIMIZED:
          if (toggle)
@@ -507,73 +1357,272 @@ view_state_request(struct wlc_compositor *compositor, struct wlc_view *view, con
    }
 }
 
+static int
+hover_settled(void *data)
+{
+   (void)data;
+
+   if (!loliwm.hover.pending)
+      return 0;
+
+   struct wlc_view *view = loliwm.hover.view;
+   hover_cancel();
+   loliwm.stats.hover_focus++;
+   set_active(loliwm.hover.compositor, view);
+   return 0;
+}
+
+static bool
+is_deep_inside(struct wlc_view *view, const struct wlc_origin *origin, uint32_t band)
+{
+   // Views too small for the band only need the pointer inside.
+   const struct wlc_geometry *g = wlc_view_get_geometry(view);
+   int32_t bx = (g->size.w > band * 2 ? band : 0), by = (g->size.h > band * 2 ? band : 0);
+   return (origin->x >= g->origin.x + bx && origin->x < g->origin.x + (int32_t)g->size.w - bx &&
+           origin->y >= g->origin.y + by && origin->y < g->origin.y + (int32_t)g->size.h - by);
+}
+
 static bool
 pointer_motion(struct wlc_compositor* compositor, struct wlc_view* view, uint32_t time, const struct wlc_origin* origin)
 {
-   (void) origin, (void)time;
+   // Pointer is still over the focused view.
+   if (loliwm.active == view) {
+      if (loliwm.hover.pending) {
+         hover_cancel();
+         loliwm.stats.hover_discarded++;
+      }
+      return true;
+   }
+
+   // Do not switch focus while pointer is only grazing the edge of a view.
+   // It has left the view it was settling on though, that one must not get focus either.
+   if (view && loliwm.hover.hysteresis > 0 && !is_deep_inside(view, origin, loliwm.hover.hysteresis)) {
+      if (loliwm.hover.pending && loliwm.hover.view != view) {
+         hover_cancel();
+         loliwm.stats.hover_discarded++;
+      }
+
+      loliwm.stats.hover_ignored++;
+      return true;
+   }
 
-   if (loliwm.active != view)
+   if (loliwm.hover.pending && loliwm.hover.view == view) {
+      // Motion events keep coming, focus as soon as the dwell time has passed.
+      if (time - loliwm.hover.since >= loliwm.hover.dwell)
+         hover_settled(NULL);
+      return true;
+   }
+
+   if (loliwm.hover.pending)
+      loliwm.stats.hover_discarded++;
+
+   if (loliwm.hover.dwell > 0 && !loliwm.hover.timer) {
+      struct wl_event_loop *loop;
+      if ((loop = event_loop()))
+         loliwm.hover.timer = wl_event_loop_add_timer(loop, hover_settled, NULL);
+   }
+
+   if (!loliwm.hover.dwell || !loliwm.hover.timer) {
+      hover_cancel();
+      loliwm.stats.hover_focus++;
       set_active(compositor, view);
+      return true;
+   }
 
+   loliwm.hover.compositor = compositor;
+   loliwm.hover.view = view;
+   loliwm.hover.since = time;
+   loliwm.hover.pending = true;
+   wl_event_source_timer_update(loliwm.hover.timer, loliwm.hover.dwell);
    return true;
 }
 
 static void
 store_rgba(const struct wlc_size *size, uint8_t *rgba)
 {
-   FILE *f;
-
-   time_t now;
-   time(&now);
-   char buf[sizeof("loliwm-0000-00-00T00:00:00Z.ppm")];
-   strftime(buf, sizeof(buf), "loliwm-%FT%TZ.ppm", gmtime(&now));
+   if (!screenshot_queue(size, rgba, (loliwm.capture.crop ? &loliwm.capture.pending : NULL)))
+      wlc_log(WLC_LOG_WARN, "screenshot dropped, it is off the output or previous ones are still being written");
+}
 
-   uint8_t *rgb;
-   if (!(rgb = calloc(1, size->w * size->h * 3)))
+static void
+screenshot(struct wlc_output *output, const struct wlc_geometry *region)
+{
+   if (!output)
       return;
 
-   if (!(f = fopen(buf, "wb"))) {
-      free(rgb);
+   // Readback is always the whole output, but only the region gets copied, converted and written.
+   loliwm.capture.crop = (region != NULL);
+   loliwm.capture.pending = (region ? *region : loliwm.capture.pending);
+   wlc_output_get_pixels(output, store_rgba);
+}
+
+static void
+record_rgba(const struct wlc_size *size, uint8_t *rgba)
+{
+   record_frame(size, rgba);
+}
+
+static int
+record_tick(void *data)
+{
+   (void)data;
+
+   if (!loliwm.record.output)
+      return 0;
+
+   // Rearm first, so the frame rate does not depend on how long the readback takes.
+   wl_event_source_timer_update(loliwm.record.timer, (1000 + loliwm.record.fps / 2) / loliwm.record.fps);
+   wlc_output_get_pixels(loliwm.record.output, record_rgba);
+   return 0;
+}
+
+static int
+recording_done(int fd, uint32_t mask, void *data)
+{
+   (void)fd, (void)mask, (void)data;
+   wl_event_source_remove(loliwm.record.done);
+   loliwm.record.done = NULL;
+   record_reap();
+   return 0;
+}
+
+static void
+stop_recording(void)
+{
+   if (loliwm.record.timer) {
+      wl_event_source_remove(loliwm.record.timer);
+      loliwm.record.timer = NULL;
+   }
+
+   loliwm.record.output = NULL;
+   record_stop();
+
+   // Writer finishes its frame in the background, without a source to tell us only waiting is left.
+   if (!loliwm.record.done)
+      record_reap();
+}
+
+static void
+toggle_recording(struct wlc_output *output)
+{
+   if (record_active()) {
+      stop_recording();
       return;
    }
 
-   for (uint32_t i = 0, c = 0; i < size->w * size->h * 4; i += 4, c += 3)
-      memcpy(rgb + c, rgba + i, 3);
+   struct wl_event_loop *loop;
+   if (!output || !loliwm.record.fps || !(loop = event_loop()))
+      return;
 
-   for (uint32_t i = 0; i * 2 < size->h; ++i) {
-      uint32_t o = i * size->w * 3;
-      uint32_t r = (size->h - 1 - i) * size->w * 3;
-      for (uint32_t i2 = size->w * 3; i2 > 0; --i2, ++o, ++r) {
-         uint8_t temp = rgb[o];
-         rgb[o] = rgb[r];
-         rgb[r] = temp;
-      }
+   if (!record_start(wlc_output_get_resolution(output), loliwm.record.fps))
+      return;
+
+   if (!(loliwm.record.timer = wl_event_loop_add_timer(loop, record_tick, NULL))) {
+      record_reap();
+      return;
    }
 
-   fprintf(f, "P6\n%d %d\n255\n", size->w, size->h);
-   fwrite(rgb, 1, size->w * size->h * 3, f);
-   free(rgb);
-   fclose(f);
+   loliwm.record.done = wl_event_loop_add_fd(loop, record_fd(), WL_EVENT_READABLE, recording_done, NULL);
+
+   loliwm.record.output = output;
+   record_tick(NULL);
 }
 
 static void
-screenshot(struct wlc_output *output)
+open_terminal(struct wlc_compositor *compositor)
 {
-   if (!output)
+   expire_launches();
+
+   struct wlc_view *view;
+   struct wlc_space *space;
+   if ((view = loliwm.terminal.ready) && (space = wlc_compositor_get_focused_space(compositor))) {
+      const uint64_t start = now_us();
+      loliwm.terminal.ready = NULL;
+      wlc_view_set_space(view, space);
+      set_active(compositor, view);
+
+      const uint64_t us = now_us() - start;
+      loliwm.stats.terminals_prewarmed++;
+      loliwm.stats.prewarmed_us += us;
+      trace(TRACE_INFO, "terminal %p mapped %" PRIu64 " us after key press (prewarmed)", (void*)view, us);
+
+      launch_terminal();
       return;
+   }
 
-   wlc_output_get_pixels(output, store_rgba);
+   if (!loliwm.terminal.wanted)
+      loliwm.terminal.pressed = now_us();
+
+   // Nothing is ready, start one for this press even if a prewarmed one is on its way.
+   // Whichever maps first is shown, the other one is kept for the next press.
+   if (launch_terminal())
+      loliwm.terminal.wanted++;
 }
 
 static void
-spawn(const char *bin)
+run_binding(struct wlc_compositor *compositor, struct wlc_view *view, const struct binding *binding)
 {
-   if (fork() == 0) {
-      setsid();
-      freopen("/dev/null", "w", stdout);
-      freopen("/dev/null", "w", stderr);
-      execlp(bin, bin, NULL);
-      _exit(EXIT_SUCCESS);
+   switch (binding->action) {
+      case ACTION_EXIT:
+         wlc_terminate();
+         break;
+      case ACTION_CLOSE:
+         wlc_view_close(view);
+         break;
+      case ACTION_TERMINAL:
+         open_terminal(compositor);
+         break;
+      case ACTION_MENU:
+         launch(MENU_APP);
+         break;
+      case ACTION_FULLSCREEN:
+         set_state(view, WLC_BIT_FULLSCREEN, !(wlc_view_get_state(view) & WLC_BIT_FULLSCREEN));
+         update_indexes(view);
+         relayout(wlc_compositor_get_focused_space(compositor));
+         break;
+      case ACTION_CYCLE:
+         cycle(compositor);
+         break;
+      case ACTION_NMASTER_EXPAND:
+      case ACTION_NMASTER_SHRINK:
+         loliwm.cut += (binding->action == ACTION_NMASTER_SHRINK ? -0.01 : 0.01);
+         if (loliwm.cut > 1.0) loliwm.cut = 1.0;
+         if (loliwm.cut < 0.0) loliwm.cut = 0.0;
+         relayout(wlc_compositor_get_focused_space(compositor));
+         break;
+      case ACTION_FOCUS_SPACE:
+         focus_space(compositor, binding->arg);
+         break;
+      case ACTION_MOVE_TO_SPACE:
+         move_to_space(compositor, view, binding->arg);
+         break;
+      case ACTION_MOVE_TO_OUTPUT:
+         move_to_output(compositor, view, binding->arg);
+         break;
+      case ACTION_ROTATE_OUTPUT:
+         focus_next_or_previous_output(compositor, true);
+         break;
+      case ACTION_FOCUS_PREVIOUS_VIEW:
+      case ACTION_FOCUS_NEXT_VIEW:
+         focus_next_or_previous_view(compositor, view, (binding->action == ACTION_FOCUS_PREVIOUS_VIEW));
+         break;
+      case ACTION_SCREENSHOT:
+         screenshot(wlc_compositor_get_focused_output(compositor), NULL);
+         break;
+      case ACTION_SCREENSHOT_VIEW:
+         screenshot(wlc_space_get_output(wlc_view_get_space(view)), wlc_view_get_geometry(view));
+         break;
+      case ACTION_SCREENSHOT_REGION:
+         if (loliwm.capture.has_region) {
+            screenshot(wlc_compositor_get_focused_output(compositor), &loliwm.capture.region);
+         } else {
+            wlc_log(WLC_LOG_WARN, "no --screenshot-region given");
+         }
+         break;
+      case ACTION_RECORD:
+         toggle_recording(wlc_compositor_get_focused_output(compositor));
+         break;
+      default:break;
    }
 }
 
@@ -582,110 +1631,118 @@ keyboard_key(struct wlc_compositor *compositor, struct wlc_view *view, uint32_t
 {
    (void)time, (void)key;
 
-   bool pass = true;
-   if (modifiers->mods == loliwm.prefix) {
-      if (sym == EXIT_KEY) {
-         if (state == WLC_KEY_STATE_PRESSED)
-            wlc_terminate();
-         pass = false;
-      } else if (view && sym == CLOSE_FOCUS_KEY) {
-         if (state == WLC_KEY_STATE_PRESSED)
-            wlc_view_close(view);
-         pass = false;
-      } else if (sym == TERM_OPEN_KEY) {
-         if (state == WLC_KEY_STATE_PRESSED) {
-            const char *terminal = getenv("TERMINAL");
-            terminal = (terminal ? terminal : DEFAULT_TERM);
-            spawn(terminal);
-         }
-         pass = false;
-      } else if (sym == MENU_OPEN_KEY) {
-         if (state == WLC_KEY_STATE_PRESSED)
-	   spawn(MENU_APP);
-         pass = false;
-      } else if (view && sym == TOGGLE_FULLSCREEN_KEY) {
-         if (state == WLC_KEY_STATE_PRESSED) {
-            wlc_view_set_state(view, WLC_BIT_FULLSCREEN, !(wlc_view_get_state(view) & WLC_BIT_FULLSCREEN));
-            relayout(wlc_compositor_get_focused_space(compositor));
-         }
-         pass = false;
-      } else if (sym == CYCLE_CLIENT_KEY) {
-         if (state == WLC_KEY_STATE_PRESSED)
-            cycle(compositor);
-         pass = false;
-      } else if (sym >= XKB_KEY_0 && sym <= XKB_KEY_9) {
-         if (state == WLC_KEY_STATE_PRESSED)
-            focus_space(compositor, (sym == XKB_KEY_0 ? 9 : sym - XKB_KEY_1));
-         pass = false;
-      } else if (sym == NMASTER_EXPAND_KEY || sym == NMASTER_SHRINK_KEY) {
-         if (state == WLC_KEY_STATE_PRESSED) {
-            loliwm.cut += (sym == NMASTER_SHRINK_KEY ? -0.01 : 0.01);
-            if (loliwm.cut > 1.0) loliwm.cut = 1.0;
-            if (loliwm.cut < 0.0) loliwm.cut = 0.0;
-            relayout(wlc_compositor_get_focused_space(compositor));
-         }
-         pass = false;
-      } else if (view && (sym == MOVE_FOCUS_OUTPUT_ONE || sym == MOVE_FOCUS_OUTPUT_TWO || sym == MOVE_FOCUS_OUTPUT_THREE)) {
-         if (state == WLC_KEY_STATE_PRESSED)
-            move_to_output(compositor, view, (sym == MOVE_FOCUS_OUTPUT_ONE ? 0 : (sym == MOVE_FOCUS_OUTPUT_TWO ? 1 : 2)));
-         pass = false;
-      } else if (view && sym >= XKB_KEY_F1 && sym <= XKB_KEY_F10) {
-         if (state == WLC_KEY_STATE_PRESSED)
-            move_to_space(compositor, view, sym - XKB_KEY_F1);
-         pass = false;
-      } else if (sym == ROTATE_OUTPUT_FOCUS_KEY) {
-         if (state == WLC_KEY_STATE_PRESSED)
-            focus_next_or_previous_output(compositor, true);
-         pass = false;
-      } else if (view && (sym == MOVE_CLIENT_FOCUS_LEFT || sym == MOVE_CLIENT_FOCUS_RIGHT)) {
-         if (state == WLC_KEY_STATE_PRESSED)
-            focus_next_or_previous_view(compositor, view, (sym == MOVE_CLIENT_FOCUS_LEFT));
-         pass = false;
-      } else if (sym == SCREENSHOT_KEY) {
-         if (state == WLC_KEY_STATE_PRESSED)
-            screenshot(wlc_compositor_get_focused_output(compositor));
-         pass = false;
-      }
+   // Bound keys are eaten on both press and release, actions run on press.
+   const struct binding *binding;
+   if ((binding = bindings_find(modifiers->mods, sym)) && (view || !binding->needs_view)) {
+      if (state == WLC_KEY_STATE_PRESSED)
+         run_binding(compositor, view, binding);
+      return false;
    }
 
-   if (pass)
-      printf("(%p) KEY: %u SYM: %u\n", view, key, sym);
+   trace(TRACE_DEBUG, "(%p) KEY: %u SYM: %u", (void*)view, key, sym);
+   return true;
+}
+
+static int
+dump_probes(int signal, void *data)
+{
+   (void)signal, (void)data;
+   probe_dump(stderr);
+   return 0;
+}
+
+static int
+dump_trace(int signal, void *data)
+{
+   (void)signal, (void)data;
+   trace_dump(stderr);
+   return 0;
+}
 
-   return pass;
+static int
+reload_bindings(int signal, void *data)
+{
+   (void)signal, (void)data;
+
+   if (bindings_load(loliwm.config, loliwm.prefix)) {
+      wlc_log(WLC_LOG_INFO, "bindings reloaded");
+   } else {
+      wlc_log(WLC_LOG_WARN, "could not reload bindings, keeping the old ones");
+   }
+
+   return 0;
 }
 
 static void
 resolution_notify(struct wlc_compositor *compositor, struct wlc_output *output, const struct wlc_size *resolution)
 {
    (void)compositor, (void)output, (void)resolution;
+
+   // Frame size is fixed in the stream header.
+   if (output == loliwm.record.output)
+      stop_recording();
+
    relayout(wlc_output_get_active_space(output));
 }
 
 static void
 output_notify(struct wlc_compositor *compositor, struct wlc_output *output)
 {
+   struct head *h;
+   if ((h = head_for_output(output)))
+      loliwm.heads.focused = h - loliwm.heads.items;
+
+   relayout_if_stale(wlc_output_get_active_space(output));
    active_space(compositor, wlc_output_get_active_space(output));
 }
 
 static void
 space_notify(struct wlc_compositor *compositor, struct wlc_space *space)
 {
+   relayout_if_stale(space);
    active_space(compositor, space);
 }
 
 static bool
 output_created(struct wlc_compositor *compositor, struct wlc_output *output)
 {
-   (void)compositor;
-
    // Add some spaces
    for (int i = 1; i < 10; ++i)
       if (!wlc_space_add(output))
          return false;
 
+   // Prewarmed terminal waits on an extra space of the first output, no key focuses it.
+   if (loliwm.terminal.prewarm && !loliwm.terminal.hidden) {
+      if (!(loliwm.terminal.hidden = wlc_space_add(output)))
+         return false;
+
+      launch_terminal();
+   }
+
+   if (!index_heads(compositor, NULL))
+      wlc_log(WLC_LOG_WARN, "outputs could not be indexed, space and output keys do nothing");
+
    return true;
 }
 
+static void
+output_destroyed(struct wlc_compositor *compositor, struct wlc_output *output)
+{
+   if (output == loliwm.record.output)
+      stop_recording();
+
+   if (loliwm.terminal.hidden && wlc_space_get_output(loliwm.terminal.hidden) == output)
+      loliwm.terminal.hidden = NULL;
+
+   // Spaces go with the output, also ones that were emptied and may still wait for a relayout.
+   struct wlc_space *space;
+   wlc_space_for_each(space, wlc_output_get_spaces(output))
+      space_forget(space);
+
+   if (!index_heads(compositor, output))
+      wlc_log(WLC_LOG_WARN, "outputs could not be indexed, space and output keys do nothing");
+}
+
 static void
 die(const char *format, ...)
 {
@@ -731,6 +1788,31 @@ parse_prefix(const char *str)
    return (prefix ? prefix : WLC_BIT_MOD_ALT);
 }
 
+// Defines handle_<fun> with the same signature as fun, for wlc_interface.
+// Only callbacks coming from wlc itself are journaled, replay recreates the nested ones.
+#define HANDLER(probe, ret, fun, params, ...) \
+   static ret handle_##fun params { \
+      if (journal_active && !loliwm.depth) journal_##fun(__VA_ARGS__); \
+      ++loliwm.depth; const uint64_t start_ = probe_begin(); const ret ret_ = fun(__VA_ARGS__); probe_end((probe), start_); --loliwm.depth; \
+      return ret_; }
+#define HANDLER_VOID(probe, fun, params, ...) \
+   static void handle_##fun params { \
+      if (journal_active && !loliwm.depth) journal_##fun(__VA_ARGS__); \
+      ++loliwm.depth; const uint64_t start_ = probe_begin(); fun(__VA_ARGS__); probe_end((probe), start_); --loliwm.depth; }
+
+HANDLER(PROBE_VIEW_CREATED, bool, view_created, (struct wlc_compositor *compositor, struct wlc_view *view, struct wlc_space *space), compositor, view, space)
+HANDLER_VOID(PROBE_VIEW_DESTROYED, view_destroyed, (struct wlc_compositor *compositor, struct wlc_view *view), compositor, view)
+HANDLER_VOID(PROBE_VIEW_SWITCH_SPACE, view_switch_space, (struct wlc_compositor *compositor, struct wlc_view *view, struct wlc_space *from, struct wlc_space *to), compositor, view, from, to)
+HANDLER_VOID(PROBE_VIEW_GEOMETRY_REQUEST, view_geometry_request, (struct wlc_compositor *compositor, struct wlc_view *view, const struct wlc_geometry *geometry), compositor, view, geometry)
+HANDLER_VOID(PROBE_VIEW_STATE_REQUEST, view_state_request, (struct wlc_compositor *compositor, struct wlc_view *view, const enum wlc_view_state_bit state, const bool toggle), compositor, view, state, toggle)
+HANDLER(PROBE_POINTER_MOTION, bool, pointer_motion, (struct wlc_compositor *compositor, struct wlc_view *view, uint32_t time, const struct wlc_origin *origin), compositor, view, time, origin)
+HANDLER(PROBE_KEYBOARD_KEY, bool, keyboard_key, (struct wlc_compositor *compositor, struct wlc_view *view, uint32_t time, const struct wlc_modifiers *modifiers, uint32_t key, uint32_t sym, enum wlc_key_state state), compositor, view, time, modifiers, key, sym, state)
+HANDLER(PROBE_OUTPUT_CREATED, bool, output_created, (struct wlc_compositor *compositor, struct wlc_output *output), compositor, output)
+HANDLER_VOID(PROBE_OUTPUT_DESTROYED, output_destroyed, (struct wlc_compositor *compositor, struct wlc_output *output), compositor, output)
+HANDLER_VOID(PROBE_OUTPUT_ACTIVATED, output_notify, (struct wlc_compositor *compositor, struct wlc_output *output), compositor, output)
+HANDLER_VOID(PROBE_OUTPUT_RESOLUTION, resolution_notify, (struct wlc_compositor *compositor, struct wlc_output *output, const struct wlc_size *resolution), compositor, output, resolution)
+HANDLER_VOID(PROBE_SPACE_ACTIVATED, space_notify, (struct wlc_compositor *compositor, struct wlc_space *space), compositor, space)
+
 int
 main(int argc, char *argv[])
 {
@@ -738,35 +1820,38 @@ main(int argc, char *argv[])
 
    static const struct wlc_interface interface = {
       .view = {
-         .created = view_created,
-         .destroyed = view_destroyed,
-         .switch_space = view_switch_space,
+         .created = handle_view_created,
+         .destroyed = handle_view_destroyed,
+         .switch_space = handle_view_switch_space,
 
          .request = {
-            .geometry = view_geometry_request,
-            .state = view_state_request,
+            .geometry = handle_view_geometry_request,
+            .state = handle_view_state_request,
          },
       },
 
       .pointer = {
-         .motion = pointer_motion,
+         .motion = handle_pointer_motion,
       },
 
       .keyboard = {
-         .key = keyboard_key,
+         .key = handle_keyboard_key,
       },
 
       .output = {
-         .created = output_created,
-         .activated = output_notify,
-         .resolution = resolution_notify,
+         .created = handle_output_created,
+         .destroyed = handle_output_destroyed,
+         .activated = handle_output_notify,
+         .resolution = handle_resolution_notify,
       },
 
       .space = {
-         .activated = space_notify,
+         .activated = handle_space_notify,
       },
    };
 
+   wl_list_init(&loliwm.dirty);
+
    if (!wlc_init(&interface, argc, argv))
       return EXIT_FAILURE;
 
@@ -782,17 +1867,130 @@ main(int argc, char *argv[])
    // do not care about childs
    sigaction(SIGCHLD, &action, NULL);
 
+   const char *trace_file = NULL, *journal_file = NULL;
+
+   // Command line wins over environment.
+   enum encode_format format = ENCODE_PPM;
+   const char *env;
+   if ((env = getenv("LOLIWM_SCREENSHOT_FORMAT")) && !encode_format_from_name(env, &format))
+      wlc_log(WLC_LOG_WARN, "unknown LOLIWM_SCREENSHOT_FORMAT %s, using ppm", env);
+
    for (int i = 1; i < argc; ++i) {
       if (!strcmp(argv[i], "--prefix")) {
          if (i + 1 >= argc)
             die("--prefix takes an argument (shift,caps,ctrl,alt,logo,mod2,mod3,mod5)");
          loliwm.prefix = parse_prefix(argv[++i]);
+      } else if (!strcmp(argv[i], "--prewarm-terminal")) {
+         loliwm.terminal.prewarm = true;
+      } else if (!strcmp(argv[i], "--trace")) {
+         if (i + 1 >= argc)
+            die("--trace takes an argument (file, - for stderr)");
+         trace_file = argv[++i];
+      } else if (!strcmp(argv[i], "--trace-level")) {
+         if (i + 1 >= argc || !trace_level_from_name(argv[++i], &trace_level))
+            die("--trace-level takes an argument (off,error,warn,info,debug)");
+      } else if (!strcmp(argv[i], "--journal")) {
+         if (i + 1 >= argc)
+            die("--journal takes an argument (file)");
+         journal_file = argv[++i];
+      } else if (!strcmp(argv[i], "--config")) {
+         if (i + 1 >= argc)
+            die("--config takes an argument (bindings file)");
+         loliwm.config = argv[++i];
+      } else if (!strcmp(argv[i], "--screenshot-format")) {
+         if (i + 1 >= argc || !encode_format_from_name(argv[i + 1], &format))
+            die("--screenshot-format takes an argument (ppm,qoi,png)");
+         ++i;
+      } else if (!strcmp(argv[i], "--screenshot-region")) {
+         struct wlc_geometry *g = &loliwm.capture.region;
+         if (i + 1 >= argc || sscanf(argv[++i], "%ux%u+%d+%d", &g->size.w, &g->size.h, &g->origin.x, &g->origin.y) != 4)
+            die("--screenshot-region takes an argument (WxH+X+Y)");
+         loliwm.capture.has_region = true;
+      } else if (!strcmp(argv[i], "--focus-dwell")) {
+         if (i + 1 >= argc)
+            die("--focus-dwell takes an argument (milliseconds)");
+         loliwm.hover.dwell = strtoul(argv[++i], NULL, 10);
+      } else if (!strcmp(argv[i], "--focus-hysteresis")) {
+         if (i + 1 >= argc)
+            die("--focus-hysteresis takes an argument (pixels)");
+         loliwm.hover.hysteresis = strtoul(argv[++i], NULL, 10);
+      } else if (!strcmp(argv[i], "--focus-fallback")) {
+         if (i + 1 >= argc)
+            die("--focus-fallback takes an argument (mru,stacking)");
+
+         ++i;
+         if (!strcmp(argv[i], "mru")) {
+            loliwm.fallback = FOCUS_FALLBACK_MRU;
+         } else if (!strcmp(argv[i], "stacking")) {
+            loliwm.fallback = FOCUS_FALLBACK_STACKING;
+         } else {
+            die("--focus-fallback takes an argument (mru,stacking)");
+         }
+      } else if (!strcmp(argv[i], "--drag-fps")) {
+         if (i + 1 >= argc)
+            die("--drag-fps takes an argument (frames per second)");
+         loliwm.drag.fps = strtoul(argv[++i], NULL, 10);
+      } else if (!strcmp(argv[i], "--record-fps")) {
+         if (i + 1 >= argc)
+            die("--record-fps takes an argument (frames per second)");
+         loliwm.record.fps = strtoul(argv[++i], NULL, 10);
       }
    }
 
+   screenshot_set_format(format);
+
+   if (!bindings_load(loliwm.config, loliwm.prefix))
+      die("could not load bindings");
+
+   if (trace_file) {
+      FILE *f = (!strcmp(trace_file, "-") ? stderr : fopen(trace_file, "w"));
+      if (!f || !trace_drain(f))
+         die("could not trace to %s", trace_file);
+   }
+
+   if (journal_file && !journal_open(journal_file))
+      die("could not journal to %s", journal_file);
+
+   // kill -HUP reloads bindings, clients stay.
+   // kill -USR1 dumps recent trace and kill -USR2 callback latencies to stderr.
+   struct wl_event_loop *loop;
+   if (!(loop = event_loop()) || !wl_event_loop_add_signal(loop, SIGHUP, reload_bindings, NULL))
+      wlc_log(WLC_LOG_WARN, "bindings can't be reloaded with SIGHUP");
+   if (!loop || !wl_event_loop_add_signal(loop, SIGUSR1, dump_trace, NULL))
+      wlc_log(WLC_LOG_WARN, "trace can't be dumped with SIGUSR1");
+#if LOLIWM_PROBES
+   if (!loop || !wl_event_loop_add_signal(loop, SIGUSR2, dump_probes, NULL))
+      wlc_log(WLC_LOG_WARN, "latencies can't be dumped with SIGUSR2");
+#endif
+
    wlc_log(WLC_LOG_INFO, "loliwm started");
    wlc_run();
 
+   wlc_log(WLC_LOG_INFO, "configures: %" PRIu64 " pushed, %" PRIu64 " skipped as unchanged, %" PRIu64 " dialogs kept as their parent and root did not resize",
+         loliwm.stats.configures, loliwm.stats.configures_skipped, loliwm.stats.dialogs_kept);
+   wlc_log(WLC_LOG_INFO, "relayouts: %" PRIu64 " requested, %" PRIu64 " coalesced, %" PRIu64 " for spaces shown after a resolution change",
+         loliwm.stats.relayouts, loliwm.stats.relayouts_coalesced, loliwm.stats.relayouts_stale);
+   wlc_log(WLC_LOG_INFO, "restacks: %" PRIu64 " applied, %" PRIu64 " skipped as already in order", loliwm.stats.restacks, loliwm.stats.restacks_skipped);
+   wlc_log(WLC_LOG_INFO, "terminals: %" PRIu64 " prewarmed (%" PRIu64 " us avg), %" PRIu64 " launched (%" PRIu64 " us avg) from key press to map",
+         loliwm.stats.terminals_prewarmed, (loliwm.stats.terminals_prewarmed ? loliwm.stats.prewarmed_us / loliwm.stats.terminals_prewarmed : 0),
+         loliwm.stats.terminals_launched, (loliwm.stats.terminals_launched ? loliwm.stats.launched_us / loliwm.stats.terminals_launched : 0));
+   wlc_log(WLC_LOG_INFO, "hover: %" PRIu64 " focus changes, %" PRIu64 " discarded before settling, %" PRIu64 " motions ignored near edges", loliwm.stats.hover_focus, loliwm.stats.hover_discarded, loliwm.stats.hover_ignored);
+   wlc_log(WLC_LOG_INFO, "drags: %" PRIu64 " geometry requests applied, %" PRIu64 " dropped for a later one in the same frame", loliwm.stats.drag_applied, loliwm.stats.drag_dropped);
+
+   probe_dump(stderr);
+
+   // Event loop is gone with wlc, only the writer is left to stop.
+   record_reap();
+   screenshot_terminate();
+   client_release();
+   space_release();
+   bindings_release();
+   trace_terminate();
+   journal_close();
+   release_heads();
+   free(loliwm.layout.items);
+   free(loliwm.layout.views);
+   free(loliwm.restack.views);
    memset(&loliwm, 0, sizeof(loliwm));
    wlc_log(WLC_LOG_INFO, "-!- loliwm is gone, bye bye!");
    return EXIT_SUCCESS;
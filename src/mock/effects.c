@@ -0,0 +1,72 @@
+#include <sys/types.h>
+#include "mock.h"
+#include "../launch.h"
+#include "../record.h"
+
+// Stands in for launch.c and record.c in test programs. Replaying a journal with
+// mod-return or mod-r must not start programs or write recordings, the calls are counted.
+
+static struct {
+   struct mock_effects effects;
+   bool recording;
+} stub;
+
+const struct mock_effects*
+mock_effects(void)
+{
+   return &stub.effects;
+}
+
+pid_t
+launch(const char *bin)
+{
+   (void)bin;
+
+   // No view has this pid, the launch expires like one that never maps.
+   stub.effects.launched++;
+   return 0x7fffffff;
+}
+
+bool
+record_start(const struct wlc_size *size, uint32_t fps)
+{
+   (void)size, (void)fps;
+
+   if (stub.recording)
+      return false;
+
+   stub.effects.recordings++;
+   return (stub.recording = true);
+}
+
+bool
+record_frame(const struct wlc_size *size, const uint8_t *rgba)
+{
+   (void)size, (void)rgba;
+   return stub.recording;
+}
+
+void
+record_stop(void)
+{
+   stub.recording = false;
+}
+
+int
+record_fd(void)
+{
+   // No worker to wait for, loliwm reaps right away without a source.
+   return -1;
+}
+
+void
+record_reap(void)
+{
+   stub.recording = false;
+}
+
+bool
+record_active(void)
+{
+   return stub.recording;
+}
@@ -0,0 +1,56 @@
+#ifndef loliwm_mock
+#define loliwm_mock
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <wlc.h>
+
+// In-memory wlc for running loliwm without a seat or display, for test programs only.
+// Test programs also link effects.c in place of launch.c and record.c, and load only the
+// built-in bindings unless --config is given, so runs do not depend on the machine.
+// Covers the view, space and output API loliwm uses. API calls that make wlc call back
+// into the compositor (space switches, output and space activation) do so here too.
+
+// Implemented by the program linking the mock, called from wlc_init() and wlc_run().
+bool mock_init(int argc, char *argv[]);
+void mock_run(void);
+
+struct mock_stats {
+   // Focus given to a view while its destroyed callback runs.
+   uint64_t focus_destroyed;
+
+   // Calls to wlc_view_close().
+   uint64_t closed;
+};
+
+// launch() and recording calls loliwm made, see effects.c.
+struct mock_effects {
+   uint64_t launched, recordings;
+};
+
+const struct wlc_interface* mock_interface(void);
+struct wlc_compositor* mock_compositor(void);
+const struct mock_stats* mock_stats(void);
+const struct mock_effects* mock_effects(void);
+
+// View the compositor last gave keyboard focus, NULL if none.
+struct wlc_view* mock_focused(void);
+bool mock_terminated(void);
+
+// Creates an output with one space and calls output.created.
+struct wlc_output* mock_output_add(const struct wlc_size *resolution);
+// Destroys the views left on its spaces, calls output.destroyed and frees it.
+// If it had focus, the first output left gets it.
+void mock_output_remove(struct wlc_output *output);
+void mock_output_set_resolution(struct wlc_output *output, const struct wlc_size *resolution);
+
+// Creates a view on top of space and calls view.created.
+struct wlc_view* mock_view_add(struct wlc_space *space, struct wlc_view *parent, uint32_t type, uint32_t state, const struct wlc_geometry *geometry, const char *class);
+
+// Calls view.destroyed and frees the view, its children lose their parent.
+void mock_view_remove(struct wlc_view *view);
+
+// Runs idle sources and due timers, like one iteration of the compositor loop.
+void mock_dispatch(void);
+
+#endif
@@ -0,0 +1,257 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include <wlc.h>
+#include <wayland-util.h>
+#include "mock.h"
+#include "../journal.h"
+
+// loliwm-replay, feeds a journal written with --journal to the same callbacks
+// and reports how long each kind of event took.
+// Callbacks wlc makes from inside API calls are not in the journal, the mock makes them.
+
+// Journal numbers views and outputs from the same counter.
+struct object {
+   struct wlc_view *view;
+   struct wlc_output *output;
+};
+
+static struct {
+   const char *path;
+
+   struct object *objects;
+   uint32_t capacity;
+
+   struct {
+      uint64_t count, total_ns, max_ns;
+   } stats[JOURNAL_LAST];
+   uint64_t skipped;
+} replay;
+
+bool
+mock_init(int argc, char *argv[])
+{
+   for (int i = 1; i < argc; ++i) {
+      if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+         replay.path = argv[++i];
+   }
+
+   if (!replay.path) {
+      wlc_log(WLC_LOG_ERROR, "usage: %s --replay FILE [loliwm options]", argv[0]);
+      return false;
+   }
+
+   return true;
+}
+
+static struct object*
+object(uint32_t id)
+{
+   if (!id)
+      return NULL;
+
+   if (id >= replay.capacity) {
+      uint32_t capacity = (replay.capacity ? replay.capacity : 64);
+      while (capacity <= id)
+         capacity *= 2;
+
+      struct object *objects;
+      if (!(objects = realloc(replay.objects, capacity * sizeof(struct object))))
+         return NULL;
+
+      memset(objects + replay.capacity, 0, (capacity - replay.capacity) * sizeof(struct object));
+      replay.objects = objects;
+      replay.capacity = capacity;
+   }
+
+   return &replay.objects[id];
+}
+
+static struct wlc_view*
+view_for(uint32_t id)
+{
+   struct object *o;
+   return ((o = object(id)) ? o->view : NULL);
+}
+
+static struct wlc_output*
+output_for(uint32_t id)
+{
+   struct object *o;
+   return ((o = object(id)) ? o->output : NULL);
+}
+
+static struct wlc_space*
+space_for(const struct journal_space *js)
+{
+   struct wlc_output *output;
+   if (!(output = output_for(js->output)))
+      return NULL;
+
+   uint32_t index = 0;
+   struct wlc_space *space;
+   wlc_space_for_each(space, wlc_output_get_spaces(output)) {
+      if (index++ == js->index)
+         return space;
+   }
+   return NULL;
+}
+
+static bool
+dispatch(const struct journal_event *e)
+{
+   const struct wlc_interface *i = mock_interface();
+   struct wlc_compositor *compositor = mock_compositor();
+   struct wlc_view *view = view_for(e->view);
+   struct wlc_output *output;
+   struct wlc_space *space;
+   struct object *o;
+
+   switch (e->type) {
+      case JOURNAL_VIEW_CREATED:
+         if (!(o = object(e->view)) || !(space = space_for(&e->space)))
+            return false;
+         return (o->view = mock_view_add(space, view_for(e->parent), e->view_type, e->view_state, &e->geometry, e->class));
+      case JOURNAL_VIEW_DESTROYED:
+         if (!view)
+            return false;
+         mock_view_remove(view);
+         replay.objects[e->view].view = NULL;
+         return true;
+      case JOURNAL_VIEW_SWITCH_SPACE:
+         if (!view || !(space = space_for(&e->to)))
+            return false;
+         wlc_view_set_space(view, space);
+         return true;
+      case JOURNAL_VIEW_GEOMETRY_REQUEST:
+         if (!view)
+            return false;
+         if (i->view.request.geometry)
+            i->view.request.geometry(compositor, view, &e->geometry);
+         return true;
+      case JOURNAL_VIEW_STATE_REQUEST:
+         if (!view)
+            return false;
+         if (i->view.request.state)
+            i->view.request.state(compositor, view, e->state, e->toggle);
+         return true;
+      case JOURNAL_POINTER_MOTION:
+         if (i->pointer.motion)
+            i->pointer.motion(compositor, view, e->time, &e->origin);
+         return true;
+      case JOURNAL_KEYBOARD_KEY:
+         if (i->keyboard.key)
+            i->keyboard.key(compositor, view, e->time, &e->modifiers, e->key, e->sym, e->key_state);
+         return true;
+      case JOURNAL_OUTPUT_CREATED:
+         if (!(o = object(e->output)))
+            return false;
+         return (o->output = mock_output_add(&e->resolution));
+      case JOURNAL_OUTPUT_DESTROYED:
+         if (!(output = output_for(e->output)))
+            return false;
+         // Views still on it go with it.
+         for (uint32_t id = 1; id < replay.capacity; ++id) {
+            if (replay.objects[id].view && wlc_space_get_output(wlc_view_get_space(replay.objects[id].view)) == output)
+               replay.objects[id].view = NULL;
+         }
+
+         mock_output_remove(output);
+         replay.objects[e->output].output = NULL;
+         return true;
+      case JOURNAL_OUTPUT_ACTIVATED:
+         if (!(output = output_for(e->output)))
+            return false;
+         wlc_compositor_focus_output(compositor, output);
+         return true;
+      case JOURNAL_OUTPUT_RESOLUTION:
+         if (!(output = output_for(e->output)))
+            return false;
+         mock_output_set_resolution(output, &e->resolution);
+         return true;
+      case JOURNAL_SPACE_ACTIVATED:
+         if (!(space = space_for(&e->space)))
+            return false;
+         wlc_output_focus_space(wlc_space_get_output(space), space);
+         return true;
+      default:break;
+   }
+
+   return false;
+}
+
+static uint64_t
+now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+report(FILE *f, uint64_t wall_ns)
+{
+   uint64_t count = 0, total_ns = 0;
+   fprintf(f, "%-24s %10s %10s %10s %12s\n", "event", "count", "avg us", "max us", "total ms");
+
+   for (uint32_t t = 1; t < JOURNAL_LAST; ++t) {
+      if (!replay.stats[t].count)
+         continue;
+
+      fprintf(f, "%-24s %10" PRIu64 " %10.2f %10.2f %12.2f\n", journal_type_name(t), replay.stats[t].count,
+            replay.stats[t].total_ns / 1e3 / replay.stats[t].count, replay.stats[t].max_ns / 1e3, replay.stats[t].total_ns / 1e6);
+
+      count += replay.stats[t].count;
+      total_ns += replay.stats[t].total_ns;
+   }
+
+   fprintf(f, "%-24s %10" PRIu64 " %10.2f %10s %12.2f\n", "all", count, (count ? total_ns / 1e3 / count : 0), "", total_ns / 1e6);
+   fprintf(f, "%" PRIu64 " events in %.2f ms, %.0f events/s, %" PRIu64 " skipped\n", count, wall_ns / 1e6, (wall_ns ? count * 1e9 / wall_ns : 0), replay.skipped);
+   fprintf(f, "%" PRIu64 " programs not launched, %" PRIu64 " recordings not started\n", mock_effects()->launched, mock_effects()->recordings);
+}
+
+void
+mock_run(void)
+{
+   FILE *f;
+   if (!(f = fopen(replay.path, "rb"))) {
+      wlc_log(WLC_LOG_ERROR, "could not open %s", replay.path);
+      return;
+   }
+
+   if (!journal_read_header(f)) {
+      wlc_log(WLC_LOG_ERROR, "%s is not a loliwm journal", replay.path);
+      fclose(f);
+      return;
+   }
+
+   // Events are fed back to back, timers only fire if they are due when the loop runs.
+   struct journal_event e;
+   const uint64_t wall = now_ns();
+   while (!mock_terminated() && journal_read(f, &e)) {
+      const uint64_t start = now_ns();
+
+      if (!dispatch(&e)) {
+         replay.skipped++;
+         continue;
+      }
+
+      // Relayouts are flushed on idle, they belong to the event that caused them.
+      mock_dispatch();
+
+      const uint64_t ns = now_ns() - start;
+      replay.stats[e.type].count++;
+      replay.stats[e.type].total_ns += ns;
+      replay.stats[e.type].max_ns = (ns > replay.stats[e.type].max_ns ? ns : replay.stats[e.type].max_ns);
+   }
+
+   if (!feof(f) && !mock_terminated())
+      wlc_log(WLC_LOG_WARN, "%s is truncated or corrupt, stopped early", replay.path);
+
+   report(stderr, now_ns() - wall);
+   fclose(f);
+   free(replay.objects);
+   memset(&replay, 0, sizeof(replay));
+}
@@ -0,0 +1,602 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <wlc.h>
+#include <wayland-util.h>
+#include <xkbcommon/xkbcommon.h>
+#include "mock.h"
+#include "../config.h"
+#include "../bindings.h"
+
+// loliwm-stress, churns views with random parent, type and state combinations through
+// loliwm on the mock wlc, checks layout and focus invariants as it goes and reports
+// how fast views are created and destroyed.
+// Usage: loliwm-stress [--views N] [--seed N] [--check-every N] [loliwm options]
+// Before the churn a few scripted cases check focus follows mouse, they need a dwell time to run,
+// that a binding with shift fires for the shifted keysym wlc passes, that focus next follows
+// the tiled order after a cycle, that tiles changed outside of loliwm are restored, and that
+// unplugging an output with a relayout still queued for one of its spaces is safe.
+
+#define STRESS_OUTPUTS 2
+
+// Stop after printing this many violations, the count keeps going.
+#define STRESS_REPORT_MAX 16
+
+enum op {
+   OP_CREATE,
+   OP_DESTROY,
+   OP_STATE,
+   OP_GEOMETRY,
+   OP_SWITCH_SPACE,
+   OP_FOCUS_SPACE,
+   OP_RESOLUTION,
+   OP_LAST,
+};
+
+static const char *names[OP_LAST] = {
+   [OP_CREATE] = "view.created",
+   [OP_DESTROY] = "view.destroyed",
+   [OP_STATE] = "view.request.state",
+   [OP_GEOMETRY] = "view.request.geometry",
+   [OP_SWITCH_SPACE] = "view.switch_space",
+   [OP_FOCUS_SPACE] = "space.activated",
+   [OP_RESOLUTION] = "output.resolution",
+};
+
+// Percent of operations, destroy and the view ops fall back to create without live views.
+static const uint32_t weights[OP_LAST] = {
+   [OP_CREATE] = 35,
+   [OP_DESTROY] = 25,
+   [OP_STATE] = 12,
+   [OP_GEOMETRY] = 10,
+   [OP_SWITCH_SPACE] = 8,
+   [OP_FOCUS_SPACE] = 8,
+   [OP_RESOLUTION] = 2,
+};
+
+static const struct wlc_size resolutions[] = {
+   { 1920, 1080 }, { 1280, 1024 }, { 2560, 1440 }, { 800, 600 },
+};
+
+static struct {
+   uint32_t views, check_every;
+   uint64_t seed;
+
+   struct wlc_output *outputs[STRESS_OUTPUTS];
+
+   struct wlc_view **live;
+   uint32_t memb, capacity, created;
+
+   struct {
+      uint64_t count, total_ns, max_ns;
+   } ops[OP_LAST];
+
+   uint64_t checks, checked, violations;
+
+   // loliwm's own --focus-dwell and --focus-hysteresis, the scripted cases depend on them.
+   uint32_t dwell, hysteresis;
+} stress = {
+   .views = 10000,
+   .check_every = 64,
+   .seed = 1,
+   .dwell = FOCUS_DWELL_MS,
+   .hysteresis = FOCUS_HYSTERESIS,
+};
+
+bool
+mock_init(int argc, char *argv[])
+{
+   for (int i = 1; i < argc; ++i) {
+      if (!strcmp(argv[i], "--views") && i + 1 < argc) {
+         stress.views = strtoul(argv[++i], NULL, 10);
+      } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+         stress.seed = strtoull(argv[++i], NULL, 10);
+      } else if (!strcmp(argv[i], "--check-every") && i + 1 < argc) {
+         stress.check_every = strtoul(argv[++i], NULL, 10);
+      } else if (!strcmp(argv[i], "--focus-dwell") && i + 1 < argc) {
+         stress.dwell = strtoul(argv[++i], NULL, 10);
+      } else if (!strcmp(argv[i], "--focus-hysteresis") && i + 1 < argc) {
+         stress.hysteresis = strtoul(argv[++i], NULL, 10);
+      }
+   }
+
+   // xorshift gets stuck at 0.
+   stress.seed = (stress.seed ? stress.seed : 1);
+   return true;
+}
+
+static uint64_t
+now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint32_t
+next(uint32_t n)
+{
+   stress.seed ^= stress.seed << 13;
+   stress.seed ^= stress.seed >> 7;
+   stress.seed ^= stress.seed << 17;
+   return (n ? stress.seed % n : 0);
+}
+
+static struct wlc_view*
+random_view(void)
+{
+   return (stress.memb ? stress.live[next(stress.memb)] : NULL);
+}
+
+static struct wlc_space*
+random_space(struct wlc_output *output)
+{
+   struct wl_list *spaces = wlc_output_get_spaces(output);
+   uint32_t index = next(wl_list_length(spaces));
+
+   struct wlc_space *space;
+   wlc_space_for_each(space, spaces) {
+      if (!index--)
+         return space;
+   }
+   return NULL;
+}
+
+static bool
+create(void)
+{
+   if (stress.memb >= stress.capacity) {
+      uint32_t capacity = (stress.capacity ? stress.capacity * 2 : 1024);
+      void *live;
+      if (!(live = realloc(stress.live, capacity * sizeof(struct wlc_view*))))
+         return false;
+
+      stress.live = live;
+      stress.capacity = capacity;
+   }
+
+   // Dialogs open next to their parent, on the same space.
+   struct wlc_view *parent = (next(4) ? NULL : random_view());
+   struct wlc_output *output = stress.outputs[next(STRESS_OUTPUTS)];
+   struct wlc_space *space = (parent ? wlc_view_get_space(parent) : (next(2) ? wlc_output_get_active_space(output) : random_space(output)));
+
+   static const uint32_t types[] = { WLC_BIT_OVERRIDE_REDIRECT, WLC_BIT_UNMANAGED, WLC_BIT_SPLASH, WLC_BIT_MODAL, WLC_BIT_POPUP };
+   uint32_t type = 0;
+   for (uint32_t i = 0; next(3) == 0 && i < 3; ++i)
+      type |= types[next(sizeof(types) / sizeof(types[0]))];
+
+   const uint32_t state = (next(8) ? 0 : (next(2) ? WLC_BIT_FULLSCREEN : WLC_BIT_MAXIMIZED));
+   const struct wlc_geometry g = { { next(1000), next(800) }, { 1 + next(1200), 1 + next(900) } };
+
+   struct wlc_view *view;
+   if (!(view = mock_view_add(space, parent, type, state, &g, "stress")))
+      return false;
+
+   stress.live[stress.memb++] = view;
+   stress.created++;
+   return true;
+}
+
+static void
+destroy(uint32_t index)
+{
+   struct wlc_view *view = stress.live[index];
+   stress.live[index] = stress.live[--stress.memb];
+   mock_view_remove(view);
+}
+
+static enum op
+run_op(void)
+{
+   uint32_t roll = next(100);
+   enum op op = OP_CREATE;
+   for (; op < OP_LAST - 1 && roll >= weights[op]; ++op)
+      roll -= weights[op];
+
+   if (!stress.memb && op != OP_FOCUS_SPACE && op != OP_RESOLUTION)
+      op = OP_CREATE;
+
+   const struct wlc_interface *i = mock_interface();
+   struct wlc_compositor *compositor = mock_compositor();
+   struct wlc_output *output = stress.outputs[next(STRESS_OUTPUTS)];
+   struct wlc_view *view;
+   struct wlc_space *space;
+
+   switch (op) {
+      case OP_CREATE:
+         create();
+      break;
+
+      case OP_DESTROY:
+         destroy(next(stress.memb));
+      break;
+
+      case OP_STATE:
+         // Interactive resizes legitimately leave tiled views anywhere, keep to the states layout owns.
+         view = random_view();
+         i->view.request.state(compositor, view, (next(2) ? WLC_BIT_FULLSCREEN : WLC_BIT_MAXIMIZED), next(2));
+      break;
+
+      case OP_GEOMETRY:
+         view = random_view();
+         i->view.request.geometry(compositor, view, &(struct wlc_geometry){ { next(3000) - 1000, next(2000) - 500 }, { 1 + next(3000), 1 + next(2000) } });
+      break;
+
+      case OP_SWITCH_SPACE:
+         if ((view = random_view()) && (space = random_space(output)))
+            wlc_view_set_space(view, space);
+      break;
+
+      case OP_FOCUS_SPACE:
+         if ((space = random_space(output)))
+            wlc_output_focus_space(output, space);
+      break;
+
+      case OP_RESOLUTION:
+         mock_output_set_resolution(output, &resolutions[next(sizeof(resolutions) / sizeof(resolutions[0]))]);
+      break;
+
+      default:break;
+   }
+
+   return op;
+}
+
+static bool
+is_tiled(struct wlc_view *view)
+{
+   // What loliwm tiles, see is_tiled() there.
+   const uint32_t type = wlc_view_get_type(view), state = wlc_view_get_state(view);
+   return !(state & WLC_BIT_FULLSCREEN) && !wlc_view_get_parent(view) &&
+          !(type & (WLC_BIT_UNMANAGED | WLC_BIT_POPUP | WLC_BIT_SPLASH | WLC_BIT_OVERRIDE_REDIRECT | WLC_BIT_MODAL));
+}
+
+static bool
+is_fullscreen(struct wlc_view *view)
+{
+   // Fullscreen dialogs stay dialogs and splashes stay centered, see layout_kind_for_client() there.
+   const uint32_t type = wlc_view_get_type(view), state = wlc_view_get_state(view);
+   const bool dialog = !(type & (WLC_BIT_UNMANAGED | WLC_BIT_POPUP | WLC_BIT_SPLASH | WLC_BIT_OVERRIDE_REDIRECT)) && wlc_view_get_parent(view);
+   return (state & WLC_BIT_FULLSCREEN) && !dialog && !(type & WLC_BIT_SPLASH);
+}
+
+static bool
+geometry_equal(const struct wlc_geometry *a, const struct wlc_geometry *b)
+{
+   return (a->origin.x == b->origin.x && a->origin.y == b->origin.y && a->size.w == b->size.w && a->size.h == b->size.h);
+}
+
+static bool
+overlaps(const struct wlc_geometry *a, const struct wlc_geometry *b)
+{
+   return (a->origin.x < b->origin.x + (int32_t)b->size.w && b->origin.x < a->origin.x + (int32_t)a->size.w &&
+           a->origin.y < b->origin.y + (int32_t)b->size.h && b->origin.y < a->origin.y + (int32_t)a->size.h);
+}
+
+static void
+violation(struct wlc_view *view, const char *what)
+{
+   if (++stress.violations > STRESS_REPORT_MAX)
+      return;
+
+   const struct wlc_geometry *g = wlc_view_get_geometry(view);
+   wlc_log(WLC_LOG_ERROR, "after %" PRIu64 " checks: view %p (type %u, state %u, parent %p) at %dx%d+%d+%d %s",
+         stress.checks, (void*)view, wlc_view_get_type(view), wlc_view_get_state(view), (void*)wlc_view_get_parent(view),
+         g->size.w, g->size.h, g->origin.x, g->origin.y, what);
+}
+
+static void
+check_space(struct wlc_space *space)
+{
+   const struct wlc_size *r = wlc_output_get_resolution(wlc_space_get_output(space));
+
+   struct wlc_view *v, *w;
+   wlc_view_for_each(v, wlc_space_get_views(space)) {
+      const struct wlc_geometry *g = wlc_view_get_geometry(v);
+      stress.checked++;
+
+      if (is_fullscreen(v) && (g->origin.x || g->origin.y || g->size.w != r->w || g->size.h != r->h))
+         violation(v, "is fullscreen but does not cover the output");
+
+      if (!is_tiled(v))
+         continue;
+
+      if (g->origin.x < 0 || g->origin.y < 0 || g->origin.x + g->size.w > r->w || g->origin.y + g->size.h > r->h)
+         violation(v, "is tiled outside the output");
+
+      for (w = wlc_view_from_link(wlc_view_get_link(v)->next); w && wlc_view_get_link(w) != wlc_space_get_views(space); w = wlc_view_from_link(wlc_view_get_link(w)->next)) {
+         if (is_tiled(w) && overlaps(g, wlc_view_get_geometry(w)))
+            violation(v, "overlaps another tiled view");
+      }
+   }
+}
+
+static void
+check(void)
+{
+   // Inactive spaces are not on screen, only what is shown has to be right.
+   for (uint32_t i = 0; i < STRESS_OUTPUTS; ++i)
+      check_space(wlc_output_get_active_space(stress.outputs[i]));
+
+   if (mock_stats()->focus_destroyed > 0 && stress.violations < STRESS_REPORT_MAX)
+      wlc_log(WLC_LOG_ERROR, "after %" PRIu64 " checks: %" PRIu64 " views focused while being destroyed", stress.checks, mock_stats()->focus_destroyed);
+
+   stress.checks++;
+}
+
+static void
+time_op(enum op (*fun)(void))
+{
+   const uint64_t start = now_ns();
+   const enum op op = fun();
+
+   // Relayouts are flushed on idle, they belong to the operation that caused them.
+   mock_dispatch();
+
+   const uint64_t ns = now_ns() - start;
+   stress.ops[op].count++;
+   stress.ops[op].total_ns += ns;
+   stress.ops[op].max_ns = (ns > stress.ops[op].max_ns ? ns : stress.ops[op].max_ns);
+}
+
+static enum op
+destroy_last(void)
+{
+   destroy(stress.memb - 1);
+   return OP_DESTROY;
+}
+
+static void
+hover(struct wlc_view *view, uint32_t time, int32_t x, int32_t y)
+{
+   mock_interface()->pointer.motion(mock_compositor(), view, time, &(struct wlc_origin){ x, y });
+   mock_dispatch();
+}
+
+static void
+check_hover_through_edge(void)
+{
+   // Pointer starts settling on a, then leaves it through the edge band of b.
+   // Neither may get focus, c keeps it.
+   if (!stress.dwell || !stress.hysteresis) {
+      wlc_log(WLC_LOG_INFO, "hover cases need --focus-dwell and --focus-hysteresis above 0, skipped");
+      return;
+   }
+
+   struct wlc_space *space = wlc_output_get_active_space(stress.outputs[0]);
+   const struct wlc_geometry g = { { 0, 0 }, { 400, 300 } };
+   struct wlc_view *a = mock_view_add(space, NULL, 0, 0, &g, "stress");
+   struct wlc_view *b = mock_view_add(space, NULL, 0, 0, &g, "stress");
+   struct wlc_view *c = mock_view_add(space, NULL, 0, 0, &g, "stress");
+   if (!a || !b || !c) {
+      wlc_log(WLC_LOG_ERROR, "could not add views");
+      return;
+   }
+
+   mock_dispatch();
+
+   const struct wlc_geometry *ga = wlc_view_get_geometry(a), *gb = wlc_view_get_geometry(b);
+   hover(a, 1000, ga->origin.x + ga->size.w / 2, ga->origin.y + ga->size.h / 2);
+   hover(b, 1001, gb->origin.x + stress.hysteresis / 2, gb->origin.y + gb->size.h / 2);
+
+   // Let the dwell timer fire if it is still armed.
+   nanosleep(&(struct timespec){ 0, (stress.dwell + 20) * 1000000L }, NULL);
+   mock_dispatch();
+
+   if (mock_focused() != c)
+      violation((mock_focused() ? mock_focused() : a), "got focus after the pointer left through the edge of another view");
+
+   mock_view_remove(c);
+   mock_view_remove(b);
+   mock_view_remove(a);
+   mock_dispatch();
+   stress.checks++;
+}
+
+static bool
+load_bindings(const char *lines)
+{
+   // Defaults plus lines, mod being logo whatever --prefix loliwm was given.
+   // Churn sends no keys, the bindings loaded here can stay.
+   char path[] = "/tmp/loliwm-stress-XXXXXX";
+   const int fd = mkstemp(path);
+   FILE *f = (fd >= 0 ? fdopen(fd, "w") : NULL);
+   if (!f) {
+      wlc_log(WLC_LOG_ERROR, "could not write bindings");
+      if (fd >= 0) {
+         close(fd);
+         unlink(path);
+      }
+      return false;
+   }
+
+   fputs(lines, f);
+   fclose(f);
+   const bool loaded = bindings_load(path, WLC_BIT_MOD_LOGO);
+   unlink(path);
+   return loaded;
+}
+
+// Returns whether the key was passed on to the client.
+static bool
+press(struct wlc_view *view, uint32_t mods, uint32_t key, uint32_t sym)
+{
+   const struct wlc_modifiers modifiers = { 0, WLC_BIT_MOD_LOGO | mods };
+   const bool passed = mock_interface()->keyboard.key(mock_compositor(), view, 0, &modifiers, key, sym, WLC_KEY_STATE_PRESSED);
+   mock_interface()->keyboard.key(mock_compositor(), view, 1, &modifiers, key, sym, WLC_KEY_STATE_RELEASED);
+   mock_dispatch();
+   return passed;
+}
+
+static void
+check_shifted_binding(void)
+{
+   // wlc passes Q for shift+q, the binding is written lowercase like in the docs.
+   struct wlc_space *space = wlc_output_get_active_space(stress.outputs[0]);
+   const struct wlc_geometry g = { { 0, 0 }, { 400, 300 } };
+   struct wlc_view *view;
+   if (!load_bindings("mod+shift+q close\n") || !(view = mock_view_add(space, NULL, 0, 0, &g, "stress"))) {
+      wlc_log(WLC_LOG_ERROR, "could not set up shifted binding case");
+      return;
+   }
+
+   const uint64_t closed = mock_stats()->closed;
+   if (press(view, WLC_BIT_MOD_SHIFT, 24, XKB_KEY_Q) || mock_stats()->closed != closed + 1)
+      violation(view, "mod+shift+q did not fire for shifted keysym Q");
+
+   mock_view_remove(view);
+   mock_dispatch();
+   stress.checks++;
+}
+
+static void
+check_cycle_focus_next(void)
+{
+   // d is fullscreen while a, b and c cycle to c, a, b, then tiles again first in line, d, c, a, b.
+   // focus-next-view walks the list backwards, from d it has to wrap to b, the last tile on screen.
+   // With the views list left in creation order it reached c.
+   struct wlc_space *space = wlc_output_get_active_space(stress.outputs[1]);
+   const struct wlc_geometry g = { { 0, 0 }, { 400, 300 } };
+   struct wlc_view *d, *a, *b, *c;
+   if (!load_bindings("mod+h cycle\nmod+k focus-next-view\n") ||
+       !(d = mock_view_add(space, NULL, 0, WLC_BIT_FULLSCREEN, &g, "stress")) ||
+       !(a = mock_view_add(space, NULL, 0, 0, &g, "stress")) ||
+       !(b = mock_view_add(space, NULL, 0, 0, &g, "stress")) ||
+       !(c = mock_view_add(space, NULL, 0, 0, &g, "stress"))) {
+      wlc_log(WLC_LOG_ERROR, "could not set up cycle case");
+      return;
+   }
+
+   wlc_compositor_focus_output(mock_compositor(), stress.outputs[1]);
+   wlc_output_focus_space(stress.outputs[1], space);
+   mock_dispatch();
+   press(mock_focused(), 0, 43, XKB_KEY_h);
+   mock_interface()->view.request.state(mock_compositor(), d, WLC_BIT_FULLSCREEN, false);
+   mock_dispatch();
+
+   for (uint32_t i = 0; i < 4 && mock_focused() != d; ++i)
+      press(mock_focused(), 0, 45, XKB_KEY_k);
+
+   press(mock_focused(), 0, 45, XKB_KEY_k);
+   if (mock_focused() != b)
+      violation((mock_focused() ? mock_focused() : d), "focus next after cycle did not follow the tiled order");
+
+   mock_view_remove(c);
+   mock_view_remove(b);
+   mock_view_remove(a);
+   mock_view_remove(d);
+   mock_dispatch();
+   stress.checks++;
+}
+
+static void
+check_tile_restored(void)
+{
+   // Tile geometry changed behind loliwm's back has to be configured back on the next relayout.
+   struct wlc_space *space = wlc_output_get_active_space(stress.outputs[0]);
+   const struct wlc_geometry g = { { 0, 0 }, { 400, 300 } };
+   struct wlc_view *a, *b;
+   if (!(a = mock_view_add(space, NULL, 0, 0, &g, "stress")) || !(b = mock_view_add(space, NULL, 0, 0, &g, "stress"))) {
+      wlc_log(WLC_LOG_ERROR, "could not set up tile restore case");
+      return;
+   }
+
+   mock_dispatch();
+   const struct wlc_geometry tile = *wlc_view_get_geometry(a);
+   wlc_view_set_geometry(a, &(struct wlc_geometry){ { tile.origin.x + 5, tile.origin.y + 5 }, { tile.size.w / 2, tile.size.h / 2 } });
+   mock_output_set_resolution(stress.outputs[0], wlc_output_get_resolution(stress.outputs[0]));
+   mock_dispatch();
+
+   if (!geometry_equal(wlc_view_get_geometry(a), &tile))
+      violation(a, "tile was not configured back after its geometry changed outside of loliwm");
+
+   mock_view_remove(b);
+   mock_view_remove(a);
+   mock_dispatch();
+   stress.checks++;
+}
+
+static void
+check_unplug_dirty_space(void)
+{
+   // Moving the only view off a space queues a relayout of it, the output goes away before the loop idles.
+   struct wlc_output *output;
+   struct wlc_view *view;
+   if (!(output = mock_output_add(&resolutions[0])) ||
+       !(view = mock_view_add(wlc_output_get_active_space(output), NULL, 0, 0, &(struct wlc_geometry){ { 0, 0 }, { 400, 300 } }, "stress"))) {
+      wlc_log(WLC_LOG_ERROR, "could not set up unplug case");
+      return;
+   }
+
+   mock_dispatch();
+   wlc_view_set_space(view, wlc_output_get_active_space(stress.outputs[0]));
+   mock_output_remove(output);
+   mock_dispatch();
+
+   mock_view_remove(view);
+   mock_dispatch();
+   stress.checks++;
+}
+
+static void
+report(FILE *f)
+{
+   fprintf(f, "%-24s %10s %10s %10s %12s\n", "operation", "count", "avg us", "max us", "total ms");
+
+   for (uint32_t i = 0; i < OP_LAST; ++i) {
+      if (!stress.ops[i].count)
+         continue;
+
+      fprintf(f, "%-24s %10" PRIu64 " %10.2f %10.2f %12.2f\n", names[i], stress.ops[i].count,
+            stress.ops[i].total_ns / 1e3 / stress.ops[i].count, stress.ops[i].max_ns / 1e3, stress.ops[i].total_ns / 1e6);
+   }
+
+   const uint64_t churn = stress.ops[OP_CREATE].count + stress.ops[OP_DESTROY].count;
+   const uint64_t churn_ns = stress.ops[OP_CREATE].total_ns + stress.ops[OP_DESTROY].total_ns;
+   fprintf(f, "churn: %.0f views created or destroyed per second\n", (churn_ns ? churn * 1e9 / churn_ns : 0));
+   fprintf(f, "invariants: %" PRIu64 " checks over %" PRIu64 " views, %" PRIu64 " violations, %" PRIu64 " focused while destroyed\n",
+         stress.checks, stress.checked, stress.violations, mock_stats()->focus_destroyed);
+}
+
+void
+mock_run(void)
+{
+   for (uint32_t i = 0; i < STRESS_OUTPUTS; ++i) {
+      if (!(stress.outputs[i] = mock_output_add(&resolutions[i]))) {
+         wlc_log(WLC_LOG_ERROR, "could not add output");
+         return;
+      }
+   }
+
+   check_hover_through_edge();
+   check_shifted_binding();
+   check_cycle_focus_next();
+   check_tile_restored();
+   check_unplug_dirty_space();
+
+   for (uint64_t n = 1; stress.created < stress.views && !mock_terminated(); ++n) {
+      time_op(run_op);
+
+      if (stress.check_every && n % stress.check_every == 0)
+         check();
+   }
+
+   check();
+
+   while (stress.memb > 0)
+      time_op(destroy_last);
+
+   check();
+   report(stderr);
+
+   const bool failed = (stress.violations || mock_stats()->focus_destroyed);
+   free(stress.live);
+   memset(&stress, 0, sizeof(stress));
+
+   // loliwm exits successfully whatever happens, scripts need to know.
+   if (failed)
+      exit(EXIT_FAILURE);
+}
@@ -0,0 +1,536 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <wlc.h>
+#include <wayland-util.h>
+#include <wayland-server.h>
+#include "mock.h"
+
+// See mock.h, wlc_run() is left to the program linking this.
+
+struct wlc_view {
+   struct wl_list link, user_link;
+   struct wl_list children, child_link;
+   struct wlc_space *space;
+   struct wlc_view *parent;
+   struct wlc_geometry geometry;
+   uint32_t type, state;
+   char class[64];
+   bool destroying;
+};
+
+struct wlc_space {
+   struct wl_list link, views;
+   struct wlc_output *output;
+   void *userdata;
+};
+
+struct wlc_output {
+   struct wl_list link, spaces;
+   struct wlc_space *active;
+   struct wlc_size resolution;
+};
+
+struct wlc_compositor {
+   struct wl_list outputs;
+   struct wlc_output *output;
+   struct wlc_view *view;
+   void *userdata;
+};
+
+static struct {
+   const struct wlc_interface *interface;
+   struct wlc_compositor *compositor;
+   struct wl_display *display;
+   struct mock_stats stats;
+   bool terminate;
+} mock;
+
+void
+wlc_vlog(enum wlc_log_type type, const char *fmt, va_list ap)
+{
+   static const char *prefix[] = { "INFO", "WARN", "ERROR", "WAYLAND" };
+   fprintf(stderr, "[%s] ", prefix[type]);
+   vfprintf(stderr, fmt, ap);
+   fputc('\n', stderr);
+}
+
+void
+wlc_log(enum wlc_log_type type, const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   wlc_vlog(type, fmt, ap);
+   va_end(ap);
+}
+
+bool
+wlc_init(const struct wlc_interface *interface, int argc, char *argv[])
+{
+   mock.interface = interface;
+
+   // Without a config file to read loliwm falls back to built-in bindings only.
+   bool config = false;
+   for (int i = 1; i < argc; ++i)
+      config = (config || !strcmp(argv[i], "--config"));
+
+   if (!config) {
+      unsetenv("XDG_CONFIG_HOME");
+      unsetenv("HOME");
+   }
+
+   return mock_init(argc, argv);
+}
+
+void
+wlc_run(void)
+{
+   if (!mock.compositor)
+      return;
+
+   mock_run();
+
+   struct wlc_output *output, *on;
+   wl_list_for_each_safe(output, on, &mock.compositor->outputs, link) {
+      struct wlc_space *space, *sn;
+      wl_list_for_each_safe(space, sn, &output->spaces, link) {
+         struct wlc_view *view, *vn;
+         wl_list_for_each_safe(view, vn, &space->views, link)
+            free(view);
+         free(space);
+      }
+      free(output);
+   }
+
+   free(mock.compositor);
+
+   if (mock.display)
+      wl_display_destroy(mock.display);
+
+   memset(&mock, 0, sizeof(mock));
+}
+
+void
+wlc_terminate(void)
+{
+   mock.terminate = true;
+}
+
+struct wl_display*
+wlc_get_wl_display(void)
+{
+   if (!mock.display)
+      mock.display = wl_display_create();
+   return mock.display;
+}
+
+struct wlc_compositor*
+wlc_compositor_new(void *userdata)
+{
+   struct wlc_compositor *compositor;
+   if (mock.compositor || !(compositor = calloc(1, sizeof(struct wlc_compositor))))
+      return NULL;
+
+   wl_list_init(&compositor->outputs);
+   compositor->userdata = userdata;
+   return (mock.compositor = compositor);
+}
+
+void
+wlc_compositor_focus_view(struct wlc_compositor *compositor, struct wlc_view *view)
+{
+   if (view && view->destroying)
+      mock.stats.focus_destroyed++;
+
+   compositor->view = view;
+}
+
+void
+wlc_compositor_focus_output(struct wlc_compositor *compositor, struct wlc_output *output)
+{
+   compositor->output = output;
+   if (mock.interface->output.activated)
+      mock.interface->output.activated(compositor, output);
+}
+
+struct wlc_output*
+wlc_compositor_get_focused_output(struct wlc_compositor *compositor)
+{
+   return compositor->output;
+}
+
+struct wlc_space*
+wlc_compositor_get_focused_space(struct wlc_compositor *compositor)
+{
+   return (compositor->output ? compositor->output->active : NULL);
+}
+
+struct wl_list*
+wlc_compositor_get_outputs(struct wlc_compositor *compositor)
+{
+   return &compositor->outputs;
+}
+
+struct wl_list*
+wlc_output_get_link(struct wlc_output *output)
+{
+   return &output->link;
+}
+
+struct wlc_output*
+wlc_output_from_link(struct wl_list *link)
+{
+   struct wlc_output *output;
+   return (link ? wl_container_of(link, output, link) : NULL);
+}
+
+const struct wlc_size*
+wlc_output_get_resolution(struct wlc_output *output)
+{
+   return &output->resolution;
+}
+
+struct wlc_space*
+wlc_output_get_active_space(struct wlc_output *output)
+{
+   return output->active;
+}
+
+struct wl_list*
+wlc_output_get_spaces(struct wlc_output *output)
+{
+   return &output->spaces;
+}
+
+void
+wlc_output_focus_space(struct wlc_output *output, struct wlc_space *space)
+{
+   output->active = space;
+   if (mock.interface->space.activated)
+      mock.interface->space.activated(mock.compositor, space);
+}
+
+void
+wlc_output_get_pixels(struct wlc_output *output, void (*cb)(const struct wlc_size*, uint8_t *rgba))
+{
+   // Nothing is rendered.
+   (void)output, (void)cb;
+}
+
+struct wlc_space*
+wlc_space_add(struct wlc_output *output)
+{
+   struct wlc_space *space;
+   if (!(space = calloc(1, sizeof(struct wlc_space))))
+      return NULL;
+
+   wl_list_init(&space->views);
+   space->output = output;
+   wl_list_insert(output->spaces.prev, &space->link);
+
+   if (!output->active)
+      output->active = space;
+
+   return space;
+}
+
+struct wlc_output*
+wlc_space_get_output(struct wlc_space *space)
+{
+   return space->output;
+}
+
+struct wl_list*
+wlc_space_get_views(struct wlc_space *space)
+{
+   return &space->views;
+}
+
+struct wl_list*
+wlc_space_get_link(struct wlc_space *space)
+{
+   return &space->link;
+}
+
+struct wlc_space*
+wlc_space_from_link(struct wl_list *link)
+{
+   struct wlc_space *space;
+   return (link ? wl_container_of(link, space, link) : NULL);
+}
+
+void
+wlc_space_set_userdata(struct wlc_space *space, void *userdata)
+{
+   space->userdata = userdata;
+}
+
+void*
+wlc_space_get_userdata(struct wlc_space *space)
+{
+   return space->userdata;
+}
+
+void
+wlc_view_close(struct wlc_view *view)
+{
+   // Clients do not go away on their own here, the program decides when views are removed.
+   (void)view;
+   mock.stats.closed++;
+}
+
+struct wl_list*
+wlc_view_get_link(struct wlc_view *view)
+{
+   return &view->link;
+}
+
+struct wlc_view*
+wlc_view_from_link(struct wl_list *link)
+{
+   struct wlc_view *view;
+   return (link ? wl_container_of(link, view, link) : NULL);
+}
+
+struct wl_list*
+wlc_view_get_user_link(struct wlc_view *view)
+{
+   return &view->user_link;
+}
+
+struct wlc_view*
+wlc_view_from_user_link(struct wl_list *link)
+{
+   struct wlc_view *view;
+   return (link ? wl_container_of(link, view, user_link) : NULL);
+}
+
+struct wlc_space*
+wlc_view_get_space(struct wlc_view *view)
+{
+   return view->space;
+}
+
+void
+wlc_view_set_space(struct wlc_view *view, struct wlc_space *space)
+{
+   struct wlc_space *from = view->space;
+   if (from == space)
+      return;
+
+   wl_list_remove(&view->link);
+   wl_list_insert(space->views.prev, &view->link);
+   view->space = space;
+
+   if (mock.interface->view.switch_space)
+      mock.interface->view.switch_space(mock.compositor, view, from, space);
+}
+
+const struct wlc_geometry*
+wlc_view_get_geometry(struct wlc_view *view)
+{
+   return &view->geometry;
+}
+
+void
+wlc_view_set_geometry(struct wlc_view *view, const struct wlc_geometry *geometry)
+{
+   view->geometry = *geometry;
+}
+
+uint32_t
+wlc_view_get_type(struct wlc_view *view)
+{
+   return view->type;
+}
+
+uint32_t
+wlc_view_get_state(struct wlc_view *view)
+{
+   return view->state;
+}
+
+void
+wlc_view_set_state(struct wlc_view *view, uint32_t state, bool toggle)
+{
+   view->state = (toggle ? view->state | state : view->state & ~state);
+}
+
+struct wlc_view*
+wlc_view_get_parent(struct wlc_view *view)
+{
+   return view->parent;
+}
+
+void
+wlc_view_set_parent(struct wlc_view *view, struct wlc_view *parent)
+{
+   wl_list_remove(&view->child_link);
+   wl_list_init(&view->child_link);
+
+   if ((view->parent = parent))
+      wl_list_insert(parent->children.prev, &view->child_link);
+}
+
+void
+wlc_view_bring_to_front(struct wlc_view *view)
+{
+   wl_list_remove(&view->link);
+   wl_list_insert(view->space->views.prev, &view->link);
+}
+
+const char*
+wlc_view_get_class(struct wlc_view *view)
+{
+   return view->class;
+}
+
+pid_t
+wlc_view_get_pid(struct wlc_view *view)
+{
+   // Views have no client process here.
+   (void)view;
+   return 0;
+}
+
+const struct wlc_interface*
+mock_interface(void)
+{
+   return mock.interface;
+}
+
+struct wlc_compositor*
+mock_compositor(void)
+{
+   return mock.compositor;
+}
+
+const struct mock_stats*
+mock_stats(void)
+{
+   return &mock.stats;
+}
+
+struct wlc_view*
+mock_focused(void)
+{
+   return (mock.compositor ? mock.compositor->view : NULL);
+}
+
+bool
+mock_terminated(void)
+{
+   return mock.terminate;
+}
+
+struct wlc_output*
+mock_output_add(const struct wlc_size *resolution)
+{
+   struct wlc_output *output;
+   if (!mock.compositor || !(output = calloc(1, sizeof(struct wlc_output))))
+      return NULL;
+
+   wl_list_init(&output->spaces);
+   output->resolution = *resolution;
+   wl_list_insert(mock.compositor->outputs.prev, &output->link);
+
+   if (!wlc_space_add(output))
+      return NULL;
+
+   if (!mock.compositor->output)
+      mock.compositor->output = output;
+
+   if (mock.interface->output.created)
+      mock.interface->output.created(mock.compositor, output);
+
+   return output;
+}
+
+void
+mock_output_remove(struct wlc_output *output)
+{
+   struct wlc_space *space, *sn;
+   wl_list_for_each(space, &output->spaces, link) {
+      while (!wl_list_empty(&space->views))
+         mock_view_remove(wlc_view_from_link(space->views.prev));
+   }
+
+   if (mock.interface->output.destroyed)
+      mock.interface->output.destroyed(mock.compositor, output);
+
+   wl_list_for_each_safe(space, sn, &output->spaces, link)
+      free(space);
+
+   const bool focused = (mock.compositor->output == output);
+   wl_list_remove(&output->link);
+   free(output);
+
+   if (focused) {
+      mock.compositor->output = NULL;
+      if (!wl_list_empty(&mock.compositor->outputs))
+         wlc_compositor_focus_output(mock.compositor, wlc_output_from_link(mock.compositor->outputs.next));
+   }
+}
+
+void
+mock_output_set_resolution(struct wlc_output *output, const struct wlc_size *resolution)
+{
+   output->resolution = *resolution;
+
+   if (mock.interface->output.resolution)
+      mock.interface->output.resolution(mock.compositor, output, resolution);
+}
+
+struct wlc_view*
+mock_view_add(struct wlc_space *space, struct wlc_view *parent, uint32_t type, uint32_t state, const struct wlc_geometry *geometry, const char *class)
+{
+   struct wlc_view *view;
+   if (!(view = calloc(1, sizeof(struct wlc_view))))
+      return NULL;
+
+   wl_list_init(&view->user_link);
+   wl_list_init(&view->children);
+   wl_list_init(&view->child_link);
+   wl_list_insert(space->views.prev, &view->link);
+   view->space = space;
+   view->geometry = *geometry;
+   view->type = type;
+   view->state = state;
+   wlc_view_set_parent(view, parent);
+
+   if (class)
+      snprintf(view->class, sizeof(view->class), "%s", class);
+
+   if (mock.interface->view.created)
+      mock.interface->view.created(mock.compositor, view, space);
+
+   return view;
+}
+
+void
+mock_view_remove(struct wlc_view *view)
+{
+   view->destroying = true;
+
+   if (mock.interface->view.destroyed)
+      mock.interface->view.destroyed(mock.compositor, view);
+
+   if (mock.compositor->view == view)
+      mock.compositor->view = NULL;
+
+   struct wlc_view *child, *cn;
+   wl_list_for_each_safe(child, cn, &view->children, child_link)
+      wlc_view_set_parent(child, NULL);
+
+   wl_list_remove(&view->child_link);
+   wl_list_remove(&view->link);
+   free(view);
+}
+
+void
+mock_dispatch(void)
+{
+   struct wl_event_loop *loop = wl_display_get_event_loop(wlc_get_wl_display());
+   wl_event_loop_dispatch_idle(loop);
+   wl_event_loop_dispatch(loop, 0);
+}
@@ -0,0 +1,179 @@
+#include <string.h>
+#include "pixels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define HAVE_X86_SIMD 1
+#  include <immintrin.h>
+#endif
+
+typedef void (*convert_row_fun)(uint8_t *dst, const uint8_t *src, uint32_t w);
+
+static void
+convert_row_scalar(uint8_t *dst, const uint8_t *src, uint32_t w)
+{
+   for (uint32_t x = 0; x < w; ++x, dst += 3, src += 4)
+      memcpy(dst, src, 3);
+}
+
+#if HAVE_X86_SIMD
+
+__attribute__((target("sse2"))) static inline __m128i
+pack_4_sse2(__m128i v)
+{
+   // Each 64 bit lane holds two pixels, squeeze out the alpha bytes: [rgb rgb . .] [rgb rgb . .]
+   const __m128i lo = _mm_set1_epi64x(0x0000000000ffffffLL);
+   const __m128i hi = _mm_set1_epi64x(0x0000ffffff000000LL);
+   v = _mm_or_si128(_mm_and_si128(v, lo), _mm_and_si128(_mm_srli_epi64(v, 8), hi));
+
+   // Then move the upper lane next to the lower one, 12 packed bytes.
+   const __m128i keep = _mm_set_epi32(0, 0, 0x0000ffff, (int)0xffffffff);
+   const __m128i moved = _mm_set_epi32(0, (int)0xffffffff, (int)0xffff0000, 0);
+   return _mm_or_si128(_mm_and_si128(v, keep), _mm_and_si128(_mm_srli_si128(v, 2), moved));
+}
+
+__attribute__((target("sse2"))) static void
+convert_row_sse2(uint8_t *dst, const uint8_t *src, uint32_t w)
+{
+   // 16 pixels in, 48 bytes out, no stores past the row.
+   uint32_t x = 0;
+   for (; x + 16 <= w; x += 16, dst += 48, src += 64) {
+      __m128i a = pack_4_sse2(_mm_loadu_si128((const __m128i*)(src + 0)));
+      __m128i b = pack_4_sse2(_mm_loadu_si128((const __m128i*)(src + 16)));
+      __m128i c = pack_4_sse2(_mm_loadu_si128((const __m128i*)(src + 32)));
+      __m128i d = pack_4_sse2(_mm_loadu_si128((const __m128i*)(src + 48)));
+      _mm_storeu_si128((__m128i*)(dst + 0), _mm_or_si128(a, _mm_slli_si128(b, 12)));
+      _mm_storeu_si128((__m128i*)(dst + 16), _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8)));
+      _mm_storeu_si128((__m128i*)(dst + 32), _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(d, 4)));
+   }
+
+   convert_row_scalar(dst, src, w - x);
+}
+
+__attribute__((target("avx2"))) static void
+convert_row_avx2(uint8_t *dst, const uint8_t *src, uint32_t w)
+{
+   // Pack 12 bytes to the bottom of each 128 bit lane, then join the lanes.
+   const __m256i shuffle = _mm256_setr_epi8(
+         0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+         0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+   const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+   // 8 pixels in, 24 bytes out. Stores are 32 bytes wide and overlap the next one,
+   // so stop while there is still room for them inside the row.
+   uint32_t x = 0;
+   for (; x + 11 <= w; x += 8, dst += 24, src += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)src);
+      v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, shuffle), join);
+      _mm256_storeu_si256((__m256i*)dst, v);
+   }
+
+   convert_row_sse2(dst, src, w - x);
+}
+
+#endif
+
+static const struct {
+   const char *name;
+   convert_row_fun convert_row;
+} impls[] = {
+#if HAVE_X86_SIMD
+   { "avx2", convert_row_avx2 },
+   { "sse2", convert_row_sse2 },
+#endif
+   { "scalar", convert_row_scalar },
+   { NULL, NULL },
+};
+
+static int selected = -1;
+
+static bool
+supported(const char *name)
+{
+#if HAVE_X86_SIMD
+   __builtin_cpu_init();
+   if (!strcmp(name, "avx2"))
+      return __builtin_cpu_supports("avx2");
+   if (!strcmp(name, "sse2"))
+      return __builtin_cpu_supports("sse2");
+#endif
+   return !strcmp(name, "scalar");
+}
+
+static int
+select_impl(void)
+{
+   if (selected < 0) {
+      // impls are ordered from fastest to slowest
+      for (selected = 0; impls[selected].name && !supported(impls[selected].name); ++selected);
+   }
+   return selected;
+}
+
+bool
+pixels_use(const char *name)
+{
+   for (int i = 0; impls[i].name; ++i) {
+      if (strcmp(impls[i].name, name) || !supported(name))
+         continue;
+
+      selected = i;
+      return true;
+   }
+   return false;
+}
+
+const char*
+pixels_impl(void)
+{
+   return impls[select_impl()].name;
+}
+
+void
+pixels_rgba_to_rgb(uint8_t *rgb, const uint8_t *rgba, uint32_t w, uint32_t h)
+{
+   const convert_row_fun convert_row = impls[select_impl()].convert_row;
+
+   // Rows go straight to their flipped place.
+   for (uint32_t y = 0; y < h; ++y)
+      convert_row(rgb + (size_t)(h - 1 - y) * w * 3, rgba + (size_t)y * w * 4, w);
+}
+
+static inline uint8_t
+clamp_u8(int32_t v)
+{
+   return (v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+void
+pixels_rgba_to_i420(uint8_t *y, uint8_t *u, uint8_t *v, const uint8_t *rgba, uint32_t w, uint32_t h)
+{
+   const uint32_t cw = (w + 1) / 2, ch = (h + 1) / 2;
+
+   // Work on pairs of output rows, top-down, which are pairs of source rows from the bottom.
+   for (uint32_t cy = 0; cy < ch; ++cy) {
+      const uint32_t y0 = cy * 2, y1 = (y0 + 1 < h ? y0 + 1 : y0);
+      const uint8_t *r0 = rgba + (size_t)(h - 1 - y0) * w * 4;
+      const uint8_t *r1 = rgba + (size_t)(h - 1 - y1) * w * 4;
+      uint8_t *d0 = y + (size_t)y0 * w, *d1 = y + (size_t)y1 * w;
+
+      for (uint32_t cx = 0; cx < cw; ++cx) {
+         const uint32_t x0 = cx * 2, x1 = (x0 + 1 < w ? x0 + 1 : x0);
+         const uint8_t *p[4] = { r0 + x0 * 4, r0 + x1 * 4, r1 + x0 * 4, r1 + x1 * 4 };
+
+         int32_t r = 0, g = 0, b = 0;
+         for (uint32_t i = 0; i < 4; ++i) {
+            r += p[i][0], g += p[i][1], b += p[i][2];
+         }
+
+         // Odd edges write the same luma twice, that is fine.
+         d0[x0] = (77 * p[0][0] + 150 * p[0][1] + 29 * p[0][2] + 128) >> 8;
+         d0[x1] = (77 * p[1][0] + 150 * p[1][1] + 29 * p[1][2] + 128) >> 8;
+         d1[x0] = (77 * p[2][0] + 150 * p[2][1] + 29 * p[2][2] + 128) >> 8;
+         d1[x1] = (77 * p[3][0] + 150 * p[3][1] + 29 * p[3][2] + 128) >> 8;
+
+         // Sums of 4 pixels, so divide by 4 * 256. The 128 bias goes in first to keep the shift off negative values.
+         u[(size_t)cy * cw + cx] = clamp_u8((-43 * r - 85 * g + 128 * b + (128 << 10) + 512) >> 10);
+         v[(size_t)cy * cw + cx] = clamp_u8((128 * r - 107 * g - 21 * b + (128 << 10) + 512) >> 10);
+      }
+   }
+}
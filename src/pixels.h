@@ -0,0 +1,22 @@
+#ifndef loliwm_pixels
+#define loliwm_pixels
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Pixel conversion for output readbacks.
+// wlc hands out RGBA rows bottom-up, files want RGB rows top-down.
+
+// Converts and flips in a single pass, rgb must hold w * h * 3 bytes.
+void pixels_rgba_to_rgb(uint8_t *rgb, const uint8_t *rgba, uint32_t w, uint32_t h);
+
+// Converts and flips to full range BT.601 planar 4:2:0 (what Y4M calls C420jpeg).
+// Chroma planes are (w + 1) / 2 by (h + 1) / 2, each chroma sample averages a 2x2 block.
+void pixels_rgba_to_i420(uint8_t *y, uint8_t *u, uint8_t *v, const uint8_t *rgba, uint32_t w, uint32_t h);
+
+// Best implementation for the running CPU is picked on first use.
+// These are for benchmarking: scalar, sse2 or avx2. Returns false if the CPU can't run it.
+bool pixels_use(const char *name);
+const char* pixels_impl(void);
+
+#endif
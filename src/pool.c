@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "pool.h"
+
+// Header keeps elements aligned for anything they may contain.
+struct slab {
+   struct slab *next;
+   long double align;
+};
+
+static size_t
+element_size(const struct pool *pool)
+{
+   // Free elements hold the free list link.
+   const size_t align = sizeof(long double);
+   const size_t size = (pool->size > sizeof(void*) ? pool->size : sizeof(void*));
+   return (size + align - 1) / align * align;
+}
+
+static bool
+grow(struct pool *pool)
+{
+   const size_t size = element_size(pool);
+
+   struct slab *slab;
+   if (!(slab = malloc(sizeof(struct slab) + size * pool->per_slab)))
+      return false;
+
+   slab->next = pool->slabs;
+   pool->slabs = slab;
+
+   // Thread the new elements on the free list, first one on top.
+   uint8_t *elements = (uint8_t*)(slab + 1);
+   for (uint32_t i = pool->per_slab; i > 0; --i) {
+      void **element = (void**)(elements + (i - 1) * size);
+      *element = pool->free;
+      pool->free = element;
+   }
+
+   return true;
+}
+
+void*
+pool_alloc(struct pool *pool)
+{
+   if (!pool->free && !grow(pool))
+      return NULL;
+
+   void **element = pool->free;
+   pool->free = *element;
+   memset(element, 0, pool->size);
+   return element;
+}
+
+void
+pool_free(struct pool *pool, void *ptr)
+{
+   if (!ptr)
+      return;
+
+   *(void**)ptr = pool->free;
+   pool->free = ptr;
+}
+
+void
+pool_release(struct pool *pool)
+{
+   struct slab *slab, *next;
+   for (slab = pool->slabs; slab; slab = next) {
+      next = slab->next;
+      free(slab);
+   }
+
+   pool->slabs = NULL;
+   pool->free = NULL;
+}
@@ -0,0 +1,24 @@
+#ifndef loliwm_pool
+#define loliwm_pool
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed size allocations from slabs, freed elements are kept on a free list for reuse.
+// Memory goes back to the system only on pool_release().
+
+struct pool {
+   size_t size;
+   uint32_t per_slab;
+   void *free;
+   struct slab *slabs;
+};
+
+#define POOL_INIT(type, n) { .size = sizeof(type), .per_slab = (n) }
+
+// Returns zeroed element, NULL if a new slab could not be allocated.
+void* pool_alloc(struct pool *pool);
+void pool_free(struct pool *pool, void *ptr);
+void pool_release(struct pool *pool);
+
+#endif
@@ -0,0 +1,94 @@
+#include <string.h>
+#include "probe.h"
+
+#if LOLIWM_PROBES
+
+// Values below 8ns get a bucket each, then 8 buckets for every power of two up to 2^47ns.
+#define SUB_BUCKETS 8
+#define BUCKETS (SUB_BUCKETS * 46)
+
+static const char *names[PROBE_LAST] = {
+   [PROBE_VIEW_CREATED] = "view.created",
+   [PROBE_VIEW_DESTROYED] = "view.destroyed",
+   [PROBE_VIEW_SWITCH_SPACE] = "view.switch_space",
+   [PROBE_VIEW_GEOMETRY_REQUEST] = "view.request.geometry",
+   [PROBE_VIEW_STATE_REQUEST] = "view.request.state",
+   [PROBE_POINTER_MOTION] = "pointer.motion",
+   [PROBE_KEYBOARD_KEY] = "keyboard.key",
+   [PROBE_OUTPUT_CREATED] = "output.created",
+   [PROBE_OUTPUT_DESTROYED] = "output.destroyed",
+   [PROBE_OUTPUT_ACTIVATED] = "output.activated",
+   [PROBE_OUTPUT_RESOLUTION] = "output.resolution",
+   [PROBE_SPACE_ACTIVATED] = "space.activated",
+   [PROBE_RELAYOUT] = "relayout",
+   [PROBE_SET_ACTIVE] = "set_active",
+};
+
+// Callbacks all run on the compositor thread, no atomics needed.
+static struct histogram {
+   uint64_t count, max;
+   uint32_t buckets[BUCKETS];
+} histograms[PROBE_LAST];
+
+static uint32_t
+bucket_for(uint64_t ns)
+{
+   if (ns < SUB_BUCKETS)
+      return ns;
+
+   const uint32_t e = 63 - __builtin_clzll(ns);
+   const uint32_t i = (e - 2) * SUB_BUCKETS + ((ns >> (e - 3)) & (SUB_BUCKETS - 1));
+   return (i < BUCKETS ? i : BUCKETS - 1);
+}
+
+static uint64_t
+bucket_upper(uint32_t i)
+{
+   if (i < SUB_BUCKETS)
+      return i;
+
+   const uint32_t e = i / SUB_BUCKETS + 2, sub = i % SUB_BUCKETS;
+   return ((uint64_t)(SUB_BUCKETS + sub + 1) << (e - 3)) - 1;
+}
+
+void
+probe_end(enum probe probe, uint64_t start)
+{
+   const uint64_t ns = probe_begin() - start;
+   struct histogram *h = &histograms[probe];
+   h->count++;
+   h->max = (ns > h->max ? ns : h->max);
+   h->buckets[bucket_for(ns)]++;
+}
+
+static uint64_t
+percentile(const struct histogram *h, uint32_t permille)
+{
+   const uint64_t rank = (h->count * permille + 999) / 1000;
+
+   uint64_t seen = 0;
+   for (uint32_t i = 0; i < BUCKETS; ++i) {
+      if ((seen += h->buckets[i]) >= rank)
+         return (bucket_upper(i) < h->max ? bucket_upper(i) : h->max);
+   }
+   return h->max;
+}
+
+void
+probe_dump(FILE *f)
+{
+   fprintf(f, "%-24s %10s %10s %10s %10s\n", "probe", "calls", "p50 us", "p99 us", "max us");
+
+   for (uint32_t i = 0; i < PROBE_LAST; ++i) {
+      const struct histogram *h = &histograms[i];
+      if (!h->count)
+         continue;
+
+      fprintf(f, "%-24s %10llu %10.1f %10.1f %10.1f\n", names[i], (unsigned long long)h->count,
+            percentile(h, 500) / 1e3, percentile(h, 990) / 1e3, h->max / 1e3);
+   }
+
+   fflush(f);
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef loliwm_probe
+#define loliwm_probe
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Latency histograms for wlc callbacks and the expensive paths under them.
+// Buckets are log-linear, 8 per power of two, so percentiles are within ~12%.
+// Compiled out unless LOLIWM_PROBES is defined, the CMake option is on by default.
+
+enum probe {
+   PROBE_VIEW_CREATED,
+   PROBE_VIEW_DESTROYED,
+   PROBE_VIEW_SWITCH_SPACE,
+   PROBE_VIEW_GEOMETRY_REQUEST,
+   PROBE_VIEW_STATE_REQUEST,
+   PROBE_POINTER_MOTION,
+   PROBE_KEYBOARD_KEY,
+   PROBE_OUTPUT_CREATED,
+   PROBE_OUTPUT_DESTROYED,
+   PROBE_OUTPUT_ACTIVATED,
+   PROBE_OUTPUT_RESOLUTION,
+   PROBE_SPACE_ACTIVATED,
+   PROBE_RELAYOUT,
+   PROBE_SET_ACTIVE,
+   PROBE_LAST,
+};
+
+#if LOLIWM_PROBES
+
+#include <time.h>
+
+static inline uint64_t
+probe_begin(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void probe_end(enum probe probe, uint64_t start);
+
+// Writes count, p50, p99 and max of every probe that was hit.
+void probe_dump(FILE *f);
+
+#else
+
+static inline uint64_t probe_begin(void) { return 0; }
+static inline void probe_end(enum probe probe, uint64_t start) { (void)probe, (void)start; }
+static inline void probe_dump(FILE *f) { (void)f; }
+
+#endif
+
+#endif
@@ -0,0 +1,264 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "record.h"
+#include "pixels.h"
+#include "config.h"
+
+static struct {
+   pthread_t thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   FILE *file;
+   struct wlc_size size;
+
+   // Worker writes a byte to done[1] when it exits, done[0] is polled by the compositor.
+   int done[2];
+
+   // Slots of RGBA readbacks, [head, head + memb) are waiting for the worker.
+   uint8_t *slots[RECORD_SLOTS];
+   uint32_t head, memb;
+
+   // I420 frame the worker converts into, only touched by the worker.
+   uint8_t *yuv;
+
+   // running until record_stop(), joinable until record_reap(). busy while the worker writes the head slot.
+   bool running, joinable, terminate, failed, busy;
+   uint64_t written, dropped;
+} record = {
+   .mutex = PTHREAD_MUTEX_INITIALIZER,
+   .cond = PTHREAD_COND_INITIALIZER,
+   .done = { -1, -1 },
+};
+
+static size_t
+yuv_size(const struct wlc_size *size)
+{
+   return (size_t)size->w * size->h + 2 * (size_t)((size->w + 1) / 2) * ((size->h + 1) / 2);
+}
+
+static bool
+write_frame(const uint8_t *rgba)
+{
+   const size_t luma = (size_t)record.size.w * record.size.h;
+   const size_t chroma = (size_t)((record.size.w + 1) / 2) * ((record.size.h + 1) / 2);
+   uint8_t *y = record.yuv, *u = y + luma, *v = u + chroma;
+   pixels_rgba_to_i420(y, u, v, rgba, record.size.w, record.size.h);
+   return (fputs("FRAME\n", record.file) >= 0 && fwrite(record.yuv, 1, luma + 2 * chroma, record.file) == luma + 2 * chroma);
+}
+
+static void
+release_buffers(void)
+{
+   for (uint32_t i = 0; i < RECORD_SLOTS; ++i) {
+      free(record.slots[i]);
+      record.slots[i] = NULL;
+   }
+
+   free(record.yuv);
+   record.yuv = NULL;
+
+   if (record.file) {
+      fclose(record.file);
+      record.file = NULL;
+   }
+}
+
+static void
+release(void)
+{
+   release_buffers();
+
+   for (int i = 0; i < 2; ++i) {
+      if (record.done[i] >= 0)
+         close(record.done[i]);
+      record.done[i] = -1;
+   }
+}
+
+static void*
+run(void *arg)
+{
+   (void)arg;
+
+   pthread_mutex_lock(&record.mutex);
+   for (;;) {
+      while (!record.memb && !record.terminate)
+         pthread_cond_wait(&record.cond, &record.mutex);
+
+      if (!record.memb)
+         break;
+
+      // Slot stays taken until written, producer never touches it meanwhile.
+      const uint8_t *rgba = record.slots[record.head];
+      record.busy = true;
+      pthread_mutex_unlock(&record.mutex);
+
+      const bool ok = (!record.failed && write_frame(rgba));
+
+      pthread_mutex_lock(&record.mutex);
+      record.head = (record.head + 1) % RECORD_SLOTS;
+      record.memb--;
+      record.busy = false;
+      record.written += ok;
+      record.failed = !ok;
+   }
+   pthread_mutex_unlock(&record.mutex);
+
+   // Flushing and unmapping the slots take milliseconds too, keep them off the compositor thread.
+   if (fclose(record.file) != 0)
+      record.failed = true;
+   record.file = NULL;
+   release_buffers();
+
+   // If this fails record_reap() still joins, it only blocks.
+   const char byte = 0;
+   while (write(record.done[1], &byte, 1) < 0 && errno == EINTR);
+   return NULL;
+}
+
+static bool
+open_pipe(int fds[2])
+{
+   if (pipe(fds) != 0)
+      return false;
+
+   for (int i = 0; i < 2; ++i) {
+      if (fcntl(fds[i], F_SETFD, FD_CLOEXEC) != 0 || fcntl(fds[i], F_SETFL, O_NONBLOCK) != 0) {
+         close(fds[0]);
+         close(fds[1]);
+         fds[0] = fds[1] = -1;
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool
+record_start(const struct wlc_size *size, uint32_t fps)
+{
+   if (record.running || !size || !size->w || !size->h || !fps)
+      return false;
+
+   if (record.joinable) {
+      wlc_log(WLC_LOG_WARN, "previous recording is still being written, try again");
+      return false;
+   }
+
+   record.size = *size;
+   record.head = record.memb = 0;
+   record.written = record.dropped = 0;
+   record.terminate = record.failed = record.busy = false;
+
+   if (!open_pipe(record.done))
+      goto fail;
+
+   for (uint32_t i = 0; i < RECORD_SLOTS; ++i) {
+      if (!(record.slots[i] = malloc((size_t)size->w * size->h * 4)))
+         goto fail;
+   }
+
+   if (!(record.yuv = malloc(yuv_size(size))))
+      goto fail;
+
+   char buf[sizeof("loliwm-0000-00-00T00:00:00Z.y4m")];
+   const time_t now = time(NULL);
+   strftime(buf, sizeof(buf), "loliwm-%FT%TZ.y4m", gmtime(&now));
+
+   if (!(record.file = fopen(buf, "wb")))
+      goto fail;
+
+   fprintf(record.file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", size->w, size->h, fps);
+
+   if (pthread_create(&record.thread, NULL, run, NULL) != 0)
+      goto fail;
+
+   record.running = record.joinable = true;
+   wlc_log(WLC_LOG_INFO, "recording %ux%u@%u to %s", size->w, size->h, fps, buf);
+   return true;
+
+fail:
+   wlc_log(WLC_LOG_WARN, "could not start recording");
+   release();
+   return false;
+}
+
+bool
+record_frame(const struct wlc_size *size, const uint8_t *rgba)
+{
+   if (!record.running || !size || !rgba)
+      return false;
+
+   pthread_mutex_lock(&record.mutex);
+   const bool full = (record.memb >= RECORD_SLOTS);
+   const uint32_t slot = (record.head + record.memb) % RECORD_SLOTS;
+   pthread_mutex_unlock(&record.mutex);
+
+   if (full || size->w != record.size.w || size->h != record.size.h) {
+      record.dropped++;
+      return false;
+   }
+
+   // Free slots belong to us until published below.
+   memcpy(record.slots[slot], rgba, (size_t)size->w * size->h * 4);
+
+   pthread_mutex_lock(&record.mutex);
+   record.memb++;
+   pthread_cond_signal(&record.cond);
+   pthread_mutex_unlock(&record.mutex);
+   return true;
+}
+
+void
+record_stop(void)
+{
+   if (!record.running)
+      return;
+
+   // Converting and writing what is queued could take several frames, the compositor does not wait for that.
+   pthread_mutex_lock(&record.mutex);
+   const uint32_t keep = (record.busy ? 1 : 0);
+   record.dropped += record.memb - keep;
+   record.memb = keep;
+   record.terminate = true;
+   pthread_cond_signal(&record.cond);
+   pthread_mutex_unlock(&record.mutex);
+
+   record.running = false;
+}
+
+int
+record_fd(void)
+{
+   return (record.joinable ? record.done[0] : -1);
+}
+
+void
+record_reap(void)
+{
+   if (!record.joinable)
+      return;
+
+   record_stop();
+   pthread_join(record.thread, NULL);
+   record.joinable = false;
+
+   if (record.failed)
+      wlc_log(WLC_LOG_WARN, "recording stopped writing, disk full?");
+
+   wlc_log(WLC_LOG_INFO, "recording: %" PRIu64 " frames written, %" PRIu64 " dropped", record.written, record.dropped);
+   release();
+}
+
+bool
+record_active(void)
+{
+   return record.running;
+}
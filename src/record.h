@@ -0,0 +1,30 @@
+#ifndef loliwm_record
+#define loliwm_record
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <wlc.h>
+
+// Screen recording to Y4M, frames are converted and written by a worker thread.
+// Frame slots are allocated once when recording starts, a frame that finds no free slot is dropped.
+
+// Opens loliwm-<time>.y4m for frames of given size and starts the worker.
+bool record_start(const struct wlc_size *size, uint32_t fps);
+
+// Copies the readback into a free slot. Returns false if the frame was dropped.
+bool record_frame(const struct wlc_size *size, const uint8_t *rgba);
+
+// Drops queued frames and tells the worker to stop after the one it is writing, without waiting for it.
+void record_stop(void);
+
+// Readable once a stopped worker is done, so record_reap() will not block. -1 when not recording.
+int record_fd(void);
+
+// Joins a stopped worker, closes the file and frees the slots.
+// Blocks until the worker is done, unless record_fd() has become readable.
+void record_reap(void);
+
+// Recording, not counting a worker that is still finishing after record_stop().
+bool record_active(void);
+
+#endif
@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "screenshot.h"
+#include "pixels.h"
+#include "config.h"
+
+struct job {
+   struct wlc_size size;
+   enum encode_format format;
+   time_t taken;
+   uint8_t *rgba;
+};
+
+static struct {
+   pthread_t thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   struct job jobs[SCREENSHOT_QUEUE_MAX];
+   uint32_t head, memb;
+   bool running, terminate;
+   enum encode_format format;
+} worker = {
+   .mutex = PTHREAD_MUTEX_INITIALIZER,
+   .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void
+store_rgba(const struct job *job)
+{
+   FILE *f;
+
+   char buf[sizeof("loliwm-0000-00-00T00:00:00Z.ppm")];
+   size_t len = strftime(buf, sizeof(buf), "loliwm-%FT%TZ.", gmtime(&job->taken));
+   snprintf(buf + len, sizeof(buf) - len, "%s", encode_format_name(job->format));
+
+   uint8_t *rgb;
+   if (!(rgb = malloc((size_t)job->size.w * job->size.h * 3)))
+      return;
+
+   if (!(f = fopen(buf, "wb"))) {
+      free(rgb);
+      return;
+   }
+
+   pixels_rgba_to_rgb(rgb, job->rgba, job->size.w, job->size.h);
+   encode(job->format, f, rgb, job->size.w, job->size.h);
+   free(rgb);
+   fclose(f);
+}
+
+static void*
+run(void *arg)
+{
+   (void)arg;
+
+   pthread_mutex_lock(&worker.mutex);
+   for (;;) {
+      while (!worker.memb && !worker.terminate)
+         pthread_cond_wait(&worker.cond, &worker.mutex);
+
+      if (!worker.memb)
+         break;
+
+      // Keep the slot taken while writing, so the queue bounds memory of in flight jobs too.
+      struct job job = worker.jobs[worker.head];
+      pthread_mutex_unlock(&worker.mutex);
+
+      store_rgba(&job);
+      free(job.rgba);
+
+      pthread_mutex_lock(&worker.mutex);
+      worker.head = (worker.head + 1) % SCREENSHOT_QUEUE_MAX;
+      worker.memb--;
+   }
+   pthread_mutex_unlock(&worker.mutex);
+   return NULL;
+}
+
+static bool
+clip(struct wlc_geometry *out, const struct wlc_size *size, const struct wlc_geometry *region)
+{
+   if (!region) {
+      *out = (struct wlc_geometry){ { 0, 0 }, *size };
+      return true;
+   }
+
+   const int64_t x0 = (region->origin.x > 0 ? region->origin.x : 0);
+   const int64_t y0 = (region->origin.y > 0 ? region->origin.y : 0);
+   int64_t x1 = (int64_t)region->origin.x + region->size.w, y1 = (int64_t)region->origin.y + region->size.h;
+   x1 = (x1 < size->w ? x1 : size->w);
+   y1 = (y1 < size->h ? y1 : size->h);
+
+   if (x1 <= x0 || y1 <= y0)
+      return false;
+
+   *out = (struct wlc_geometry){ { x0, y0 }, { x1 - x0, y1 - y0 } };
+   return true;
+}
+
+bool
+screenshot_queue(const struct wlc_size *size, const uint8_t *rgba, const struct wlc_geometry *region)
+{
+   struct wlc_geometry g;
+   if (!size || !rgba || !size->w || !size->h || !clip(&g, size, region))
+      return false;
+
+   pthread_mutex_lock(&worker.mutex);
+   const bool full = (worker.memb >= SCREENSHOT_QUEUE_MAX);
+   pthread_mutex_unlock(&worker.mutex);
+
+   if (full)
+      return false;
+
+   struct job job = { g.size, worker.format, time(NULL), NULL };
+   if (!(job.rgba = malloc((size_t)g.size.w * g.size.h * 4)))
+      return false;
+
+   // Readback rows are bottom-up, keep them that way so the worker converts regions like whole frames.
+   const uint32_t bottom = size->h - (g.origin.y + g.size.h);
+   for (uint32_t y = 0; y < g.size.h; ++y)
+      memcpy(job.rgba + (size_t)y * g.size.w * 4, rgba + ((size_t)(bottom + y) * size->w + g.origin.x) * 4, (size_t)g.size.w * 4);
+
+   pthread_mutex_lock(&worker.mutex);
+   if (!worker.running) {
+      worker.terminate = false;
+      if (pthread_create(&worker.thread, NULL, run, NULL) != 0) {
+         pthread_mutex_unlock(&worker.mutex);
+         free(job.rgba);
+         return false;
+      }
+      worker.running = true;
+   }
+
+   worker.jobs[(worker.head + worker.memb) % SCREENSHOT_QUEUE_MAX] = job;
+   worker.memb++;
+   pthread_cond_signal(&worker.cond);
+   pthread_mutex_unlock(&worker.mutex);
+   return true;
+}
+
+void
+screenshot_set_format(enum encode_format format)
+{
+   worker.format = format;
+}
+
+void
+screenshot_terminate(void)
+{
+   pthread_mutex_lock(&worker.mutex);
+   if (!worker.running) {
+      pthread_mutex_unlock(&worker.mutex);
+      return;
+   }
+
+   worker.terminate = true;
+   pthread_cond_signal(&worker.cond);
+   pthread_mutex_unlock(&worker.mutex);
+
+   pthread_join(worker.thread, NULL);
+   worker.running = false;
+}
@@ -0,0 +1,22 @@
+#ifndef loliwm_screenshot
+#define loliwm_screenshot
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <wlc.h>
+#include "encode.h"
+
+// Screenshots are converted and written by a worker thread, so the compositor only pays for the readback.
+
+// Copies the readback and hands it to the worker.
+// Only the region (top-left origin, clipped to the readback) is copied and written, NULL takes all of it.
+// Returns false if too many screenshots are still being written, the screenshot is dropped then.
+bool screenshot_queue(const struct wlc_size *size, const uint8_t *rgba, const struct wlc_geometry *region);
+
+// Format for screenshots queued from now on, PPM by default.
+void screenshot_set_format(enum encode_format format);
+
+// Waits for queued screenshots to be written and stops the worker.
+void screenshot_terminate(void);
+
+#endif
@@ -0,0 +1,146 @@
+#include <stdlib.h>
+#include <assert.h>
+#include "space.h"
+#include "client.h"
+#include "pool.h"
+
+static struct pool pool = POOL_INIT(struct space, 16);
+
+struct space*
+space_new(struct wlc_space *handle)
+{
+   struct space *space;
+   if (!(space = pool_alloc(&pool)))
+      return NULL;
+
+   space->space = handle;
+   wl_list_init(&space->views);
+   wl_list_init(&space->tiled);
+   wl_list_init(&space->fullscreen);
+   wl_list_init(&space->focus);
+   wl_list_init(&space->dirty_link);
+   return space;
+}
+
+void
+space_free(struct space *space)
+{
+   if (!space)
+      return;
+
+   struct client *c, *cn;
+   wl_list_for_each_safe(c, cn, &space->tiled, tiled_link)
+      space_untile(space, c);
+
+   wl_list_for_each_safe(c, cn, &space->fullscreen, fullscreen_link)
+      space_set_fullscreen(space, c, false);
+
+   wl_list_for_each_safe(c, cn, &space->focus, focus_link)
+      space_forget_focus(space, c);
+
+   pool_free(&pool, space);
+}
+
+void
+space_release(void)
+{
+   pool_release(&pool);
+}
+
+void
+space_tile(struct space *space, struct client *c, struct client *after)
+{
+   assert(space && c && !c->tiled);
+   assert(!after || after->tiled);
+   wl_list_insert((after ? &after->tiled_link : &space->tiled), &c->tiled_link);
+   c->tiled = true;
+   space->tiled_count++;
+}
+
+void
+space_untile(struct space *space, struct client *c)
+{
+   assert(space && c);
+
+   if (!c->tiled)
+      return;
+
+   wl_list_remove(&c->tiled_link);
+   wl_list_init(&c->tiled_link);
+   c->tiled = false;
+   space->tiled_count--;
+}
+
+void
+space_set_fullscreen(struct space *space, struct client *c, bool fullscreen)
+{
+   assert(space && c);
+
+   if (c->fullscreen == fullscreen)
+      return;
+
+   wl_list_remove(&c->fullscreen_link);
+   wl_list_init(&c->fullscreen_link);
+
+   // Views go fullscreen on top.
+   if (fullscreen)
+      wl_list_insert(space->fullscreen.prev, &c->fullscreen_link);
+
+   c->fullscreen = fullscreen;
+}
+
+void
+space_raise(struct space *space, struct client *c)
+{
+   assert(space && c);
+
+   client_raise(c);
+
+   if (c->fullscreen) {
+      wl_list_remove(&c->fullscreen_link);
+      wl_list_insert(space->fullscreen.prev, &c->fullscreen_link);
+   }
+}
+
+void
+space_note_focus(struct space *space, struct client *c, bool recent)
+{
+   assert(space && c);
+   wl_list_remove(&c->focus_link);
+   wl_list_insert((recent ? space->focus.prev : &space->focus), &c->focus_link);
+}
+
+void
+space_forget_focus(struct space *space, struct client *c)
+{
+   assert(space && c);
+   (void)space;
+   wl_list_remove(&c->focus_link);
+   wl_list_init(&c->focus_link);
+}
+
+struct client*
+space_last_focused(struct space *space)
+{
+   assert(space);
+
+   if (wl_list_empty(&space->focus))
+      return NULL;
+
+   struct client *c;
+   return wl_container_of(space->focus.prev, c, focus_link);
+}
+
+bool
+space_cycle(struct space *space)
+{
+   assert(space);
+
+   if (space->tiled_count <= 1)
+      return false;
+
+   struct wl_list *last = space->tiled.prev;
+   wl_list_remove(last);
+   wl_list_insert(&space->tiled, last);
+   return true;
+}
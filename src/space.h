@@ -0,0 +1,68 @@
+#ifndef loliwm_space
+#define loliwm_space
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <wayland-util.h>
+#include <wlc.h>
+
+struct client;
+struct wlc_space;
+
+// Userdata of every wlc_space loliwm has put views on.
+
+struct space {
+   struct wlc_space *space;
+
+   // All views in user order, linked through wlc_view_get_user_link().
+   struct wl_list views;
+
+   // Tiled clients in layout order, linked through client.tiled_link.
+   struct wl_list tiled;
+   uint32_t tiled_count;
+
+   // Fullscreen clients in stacking order with the topmost last, linked through client.fullscreen_link.
+   struct wl_list fullscreen;
+
+   // Managed clients by when they last had focus, most recent last, linked through client.focus_link.
+   // Focus falls back to the last one when the focused view goes away.
+   struct wl_list focus;
+
+   // Bemenu listed on this space, there is only ever one.
+   struct client *bemenu;
+
+   // Waiting for relayout, linked in the dirty list of loliwm.c.
+   struct wl_list dirty_link;
+   bool dirty;
+
+   // Output resolution of the last relayout, inactive spaces catch up when activated.
+   struct wlc_size laid_out;
+};
+
+struct space* space_new(struct wlc_space *space);
+// Space has to be off the dirty list already.
+void space_free(struct space *space);
+
+// Frees every space, also the ones still in use.
+void space_release(void);
+
+// Adds client to tiled list after another tiled client, or first if after is NULL.
+void space_tile(struct space *space, struct client *c, struct client *after);
+void space_untile(struct space *space, struct client *c);
+
+void space_set_fullscreen(struct space *space, struct client *c, bool fullscreen);
+
+// Keeps stacking ordered indexes in sync when the client is brought to front.
+void space_raise(struct space *space, struct client *c);
+
+// Moves client to the most recently focused end of the focus history, or the least recent one if recent is false.
+void space_note_focus(struct space *space, struct client *c, bool recent);
+void space_forget_focus(struct space *space, struct client *c);
+
+// Most recently focused client still on the space, NULL if there is none.
+struct client* space_last_focused(struct space *space);
+
+// Moves the last tiled client first, in constant time. Returns false if there was nothing to rotate.
+bool space_cycle(struct space *space);
+
+#endif
@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "trace.h"
+#include "config.h"
+
+// seq is 2 * ticket + 1 while the message is written, 2 * ticket + 2 once it is complete.
+// Readers copy the slot and check seq did not move meanwhile, like a seqlock.
+struct slot {
+   uint64_t seq, ns;
+   enum trace_level level;
+   char message[TRACE_MESSAGE_MAX];
+};
+
+enum read_result {
+   READ_OK,
+   READ_PENDING,
+   READ_LOST,
+};
+
+static const char *names[] = {
+   [TRACE_OFF] = "off",
+   [TRACE_ERROR] = "error",
+   [TRACE_WARN] = "warn",
+   [TRACE_INFO] = "info",
+   [TRACE_DEBUG] = "debug",
+};
+
+enum trace_level trace_level = TRACE_DEFAULT_LEVEL;
+
+static struct slot ring[TRACE_RING_SIZE];
+static uint64_t head;
+
+static struct {
+   pthread_t thread;
+   FILE *file;
+   uint64_t tail;
+   bool running, terminate;
+} drain;
+
+bool
+trace_level_from_name(const char *name, enum trace_level *level)
+{
+   for (uint32_t i = 0; name && i < sizeof(names) / sizeof(names[0]); ++i) {
+      if (strcmp(names[i], name))
+         continue;
+
+      *level = i;
+      return true;
+   }
+   return false;
+}
+
+void
+trace_push(enum trace_level level, const char *format, ...)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   const uint64_t ticket = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+   struct slot *s = &ring[ticket & (TRACE_RING_SIZE - 1)];
+
+   __atomic_store_n(&s->seq, 2 * ticket + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+
+   s->ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+   s->level = level;
+
+   va_list args;
+   va_start(args, format);
+   vsnprintf(s->message, sizeof(s->message), format, args);
+   va_end(args);
+
+   __atomic_store_n(&s->seq, 2 * ticket + 2, __ATOMIC_RELEASE);
+}
+
+static enum read_result
+read_slot(uint64_t ticket, struct slot *out)
+{
+   const struct slot *s = &ring[ticket & (TRACE_RING_SIZE - 1)];
+
+   const uint64_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+   if (seq < 2 * ticket + 2)
+      return READ_PENDING;
+   if (seq > 2 * ticket + 2)
+      return READ_LOST;
+
+   memcpy(out, s, sizeof(struct slot));
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   return (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == seq ? READ_OK : READ_LOST);
+}
+
+static void
+print_slot(FILE *f, const struct slot *s)
+{
+   fprintf(f, "[%llu.%06llu] %-5s %s\n", (unsigned long long)(s->ns / 1000000000), (unsigned long long)(s->ns / 1000 % 1000000), names[s->level], s->message);
+}
+
+static void
+drain_once(void)
+{
+   const uint64_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+
+   uint64_t lost = 0;
+   if (h - drain.tail > TRACE_RING_SIZE) {
+      lost = h - TRACE_RING_SIZE - drain.tail;
+      drain.tail = h - TRACE_RING_SIZE;
+   }
+
+   struct slot s;
+   for (; drain.tail < h; ++drain.tail) {
+      const enum read_result r = read_slot(drain.tail, &s);
+      if (r == READ_PENDING)
+         break;
+
+      if (r == READ_LOST) {
+         ++lost;
+         continue;
+      }
+
+      if (lost) {
+         fprintf(drain.file, "-- %llu messages lost --\n", (unsigned long long)lost);
+         lost = 0;
+      }
+
+      print_slot(drain.file, &s);
+   }
+
+   if (lost)
+      fprintf(drain.file, "-- %llu messages lost --\n", (unsigned long long)lost);
+
+   fflush(drain.file);
+}
+
+static void*
+run(void *arg)
+{
+   (void)arg;
+
+   const struct timespec interval = { TRACE_DRAIN_MS / 1000, (TRACE_DRAIN_MS % 1000) * 1000000 };
+   while (!__atomic_load_n(&drain.terminate, __ATOMIC_ACQUIRE)) {
+      drain_once();
+      nanosleep(&interval, NULL);
+   }
+
+   drain_once();
+   return NULL;
+}
+
+bool
+trace_drain(FILE *f)
+{
+   if (!f || drain.running)
+      return false;
+
+   drain.file = f;
+   drain.tail = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+   drain.terminate = false;
+
+   if (pthread_create(&drain.thread, NULL, run, NULL) != 0)
+      return false;
+
+   drain.running = true;
+   return true;
+}
+
+void
+trace_dump(FILE *f)
+{
+   const uint64_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+
+   struct slot s;
+   for (uint64_t t = (h > TRACE_RING_SIZE ? h - TRACE_RING_SIZE : 0); t < h; ++t) {
+      if (read_slot(t, &s) == READ_OK)
+         print_slot(f, &s);
+   }
+
+   fflush(f);
+}
+
+void
+trace_terminate(void)
+{
+   if (!drain.running)
+      return;
+
+   __atomic_store_n(&drain.terminate, true, __ATOMIC_RELEASE);
+   pthread_join(drain.thread, NULL);
+
+   if (drain.file != stderr && drain.file != stdout)
+      fclose(drain.file);
+
+   drain.file = NULL;
+   drain.running = false;
+}
@@ -0,0 +1,40 @@
+#ifndef loliwm_trace
+#define loliwm_trace
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// In-memory trace ring for per-event logging, never blocks the caller.
+// Messages are formatted into a slot of a fixed ring, the oldest ones get overwritten.
+// A drain thread streams the ring to a file if asked to, trace_dump() prints the recent history.
+
+enum trace_level {
+   TRACE_OFF,
+   TRACE_ERROR,
+   TRACE_WARN,
+   TRACE_INFO,
+   TRACE_DEBUG,
+};
+
+extern enum trace_level trace_level;
+
+// Disabled levels cost a compare, arguments are not evaluated.
+#define trace(level, ...) do { if ((level) <= trace_level) trace_push((level), __VA_ARGS__); } while (0)
+
+__attribute__((format(printf, 2, 3)))
+void trace_push(enum trace_level level, const char *format, ...);
+
+// Returns false if name is not a level: off, error, warn, info, debug.
+bool trace_level_from_name(const char *name, enum trace_level *level);
+
+// Starts a thread streaming new messages to f, which it owns from now on.
+bool trace_drain(FILE *f);
+
+// Writes what the ring still holds, oldest first. Safe while messages are pushed.
+void trace_dump(FILE *f);
+
+// Flushes and stops the drain thread.
+void trace_terminate(void);
+
+#endif